@@ -22,86 +22,11 @@ CH_STYLE(AccordionCtrl, Style, StyleDefault)
     sectionVGap         = 2;
     borderWidth         = 0;
     animMs              = 120;
+    bodyBottomPad       = 8;
+    indentCx            = 16;
     focusHeaderOnToggle = true;
 }
 
-static Image MakeChevronRight(int sz, Color ink) {
-    ImageBuffer ib(sz, sz);
-    Fill(~ib, RGBAZero(), ib.GetLength());
-    BufferPainter p(ib); // AA vector drawing
-
-    int cx = sz / 2, cy = sz / 2;
-    int w = sz / 3;
-    Vector<Point> pts;
-    pts << Point(cx - w/2, cy - w) << Point(cx + w/2, cy) << Point(cx - w/2, cy + w);
-    p.DrawPolyline(pts, 2, ink);
-    return ib;
-}
-
-static Image MakeChevronDown(int sz, Color ink) {
-    ImageBuffer ib(sz, sz);
-    Fill(~ib, RGBAZero(), ib.GetLength());
-    BufferPainter p(ib); // AA vector drawing
-    int cx = sz / 2, cy = sz / 2;
-    int w = sz / 3;
-    Vector<Point> pts;
-    pts << Point(cx - w, cy - w/2) << Point(cx, cy + w/2) << Point(cx + w, cy - w/2);
-    p.DrawPolyline(pts, 2, ink);
-    return ib;
-}
-
-// High‑fidelity lock icon with anti‑aliasing, scaled to sz×sz, drawn in 'ink'
-static Image MakeChevronLock(int sz, Color ink) {
-    // Transparent buffer
-    ImageBuffer ib(sz, sz);
-    Fill(~ib, RGBAZero(), ib.GetLength());
-    BufferPainter p(ib); // AA vector drawing
-
-    // Proportional inset so thick strokes don’t clip at edges
-    const double margin = max(0.5, round(sz * 0.04));
-    const Rectf inset(margin, margin, sz - margin, sz - margin);
-    const double W = inset.GetWidth();
-    const double H = inset.GetHeight();
-
-    auto X = [&](double fx){ return inset.left + W * fx; };
-    auto Y = [&](double fy){ return inset.top  + H * fy; };
-
-    // Stroke thickness scaled to size (looks good ~12–28px)
-    const double T = max(0.5, round(sz * 0.18));     // outline thickness
-    const double Tk = max(0.5, round(T * 0.85));     // keyhole stem
-
-    // 1) Body rectangle outline (your proportions)
-    p.Begin();
-    p.Move(Pointf(X(0.1288), Y(0.4206)));
-    p.Line(Pointf(X(0.8498), Y(0.4206)));
-    p.Line(Pointf(X(0.8498), Y(0.9442)));
-    p.Line(Pointf(X(0.1288), Y(0.9442)));
-    p.Close();
-    p.Stroke(T, ink);
-
-    // 2) Shackle curve (cubic)
-    p.Begin();
-    p.Move(Pointf(X(0.2575), Y(0.3863)));
-    p.Cubic(Pointf(X(0.2575), Y(0.0086)),
-            Pointf(X(0.7210), Y(0.0086)),
-            Pointf(X(0.7210), Y(0.3863)));
-    p.Stroke(T, ink);
-
-    // 3) Keyhole circle (filled)
-    const double R = min(W, H) * 0.0716;
-    p.Begin();
-    p.Circle(X(0.4614), Y(0.6438), R);
-    p.Fill(ink);
-
-    // 4) Keyhole stem (stroke)
-    p.Begin();
-    p.Move(Pointf(X(0.4635), Y(0.8219)));
-    p.Line(Pointf(X(0.4635), Y(0.6953)));
-    p.Stroke(Tk, ink);
-
-    return ib;
-}
-
 AccordionCtrl::AccordionCtrl()
     : style(&StyleDefault())
     , singleExpand(false)
@@ -109,182 +34,470 @@ AccordionCtrl::AccordionCtrl()
     , hotSection(-1)
     , pressedSection(-1)
 {
-    iconClosed = MakeChevronRight(12, SColorText());
-    iconOpened = MakeChevronDown(12, SColorText());
-    iconLock = MakeChevronLock(12, SColorText());
+    sb.AutoHide();
+    sb.WhenScroll = [=] { OnScroll(); };
+    AddFrame(sb);
+    ONCELOCK {
+        InstallStateHook(StateHook);
+    }
+}
+
+AccordionCtrl::~AccordionCtrl() {
+    // Running workers see their token canceled, the Ptr guard drops their results
+    for(Section *s : asyncPending)
+        s->async->job->canceled = true;
+    // Members declared after 'sections' and 'slots' are gone when the panes are destroyed,
+    // so the pane children must not report back (as in Clear and RemoveOne)
+    for(Section& s : sections) {
+        if(s.header) s.header->owner = nullptr;
+        if(s.body) s.body->owner = nullptr;
+    }
+    for(Slot& q : slots) {
+        q.header.owner = nullptr;
+        q.body.owner = nullptr;
+    }
 }
 
 AccordionCtrl& AccordionCtrl::SetStyle(const Style& st) {
     style = &st;
-    Refresh();
+    InvalidateHeaders();
+    GeometryChanged();
+    Relayout();
     return *this;
 }
 
 const AccordionCtrl::Style& AccordionCtrl::GetStyle() const { return *style; }
-int  AccordionCtrl::GetCount() const { return sections.GetCount(); }
+int  AccordionCtrl::GetCount() const { return model ? vbody.GetCount() : sections.GetCount(); }
 int  AccordionCtrl::AddSection(const String& title) { return InsertSection(sections.GetCount(), title); }
 
+int AccordionCtrl::AddSection(const String& title, Event<ParentCtrl&> factory) {
+    int i = AddSection(title);
+    SetBodyFactory(i, pick(factory));
+    return i;
+}
+
 int AccordionCtrl::InsertSection(int at, const String& title) {
+    ASSERT(!model);
     ASSERT(at >= 0 && at <= sections.GetCount());
+    return InsertChild(at, at < sections.GetCount() ? sections[at].parent : nullptr, title);
+}
+
+int AccordionCtrl::AddSection(int parent, const String& title) {
+    ASSERT(!model && parent >= 0 && parent < sections.GetCount());
+    return InsertChild(SubtreeEnd(parent), &sections[parent], title);
+}
+
+int AccordionCtrl::InsertChild(int at, Section *parent, const String& title) {
     Section& s = sections.Insert(at);
     s.title = title;
-    s.open = false;
+    if(parent) {
+        s.parent = parent;
+        s.depth = parent->depth + 1;
+        parent->childCount++;
+        nestedCount++;
+        s.collapsed = parent->collapsed || !openBits[IndexOf(*parent)];
+    }
     s.animating = false;
     s.currentBodyCy = 0;
     s.targetBodyCy = 0;
-    s.animTicket = 0;
-    s.hot = false;
-    s.pressed = false;
-    s.lock = UNLOCKED; // NEW
+    s.index = at;
+    InsertStateBits(at);
 
     s.header.Create<HeaderPane>();
-    s.body.Create<ParentCtrl>();
     s.header->owner = this;
-
-    Add(s.header->SizePos());
-    Add(s.body->SizePos());
-
-    UpdateHeaderIndices();
-    RefreshLayout();
+    s.header->index = at;
+
+    // Hidden until a Layout pass finds it inside the viewport; body pane is created on demand
+    s.header->Hide();
+    Add(*s.header);
+
+    if(hotSection >= at) hotSection++;
+    if(pressedSection >= at) pressedSection++;
+    if(focusSection >= at) focusSection++;
+    GeometryChanged();
+    SectionsMoved(at);
+    if(filtering)
+        FilterInserted(at);
+    if(s.collapsed || s.filtered) {
+        s.hidden = true;
+        hiddenCount++;
+    }
+    Relayout();
     return at;
 }
 
 void AccordionCtrl::RemoveSection(int i) {
+    ASSERT(!model);
     ASSERT(i >= 0 && i < sections.GetCount());
+    if(sections[i].childCount == 0) {
+        RemoveOne(i);
+        return;
+    }
+    Batch batch(*this);
+    for(int j = SubtreeEnd(i) - 1; j >= i; j--) // children first
+        RemoveOne(j);
+}
+
+void AccordionCtrl::RemoveOne(int i) {
+    BodyOpened(sections[i]); // not a closed body the budget could release any more
     StopAnimation(i);
     if(sections[i].header) sections[i].header->Remove();
-    if(sections[i].body)   sections[i].body->Remove();
-    sections.Remove(i);
-
-    if(enforceOne && sections.GetCount() > 0) {
-        bool anyOpen = false;
-        for(int j = 0; j < sections.GetCount(); j++)
-            if(sections[j].open) { anyOpen = true; break; }
-        if(!anyOpen) Open(0, false);
+    if(sections[i].body) {
+        sections[i].body->owner = nullptr;
+        sections[i].body->Remove();
+    }
+    for(int j = 0; j < shown.GetCount(); j++)
+        if(shown[j] == &sections[i]) { shown.Remove(j); break; }
+    for(int j = 0; j < remeasure.GetCount(); j++)
+        if(remeasure[j] == &sections[i]) { remeasure.Remove(j); break; }
+    for(int j = 0; j < reflow.GetCount(); j++)
+        if(reflow[j] == &sections[i]) { reflow.Remove(j); break; }
+    RemoveStateBits(i);
+    UnlinkKey(sections[i]);
+    CancelAsync(sections[i]);
+    ForgetPrewarm(sections[i]);
+    for(LruEntry& e : lru)
+        if(e.section == &sections[i]) e.section = nullptr;
+    for(int k = 0; k < updateKeeps.GetCount(); k++)
+        if(updateKeeps[k] == &sections[i]) { updateKeeps.Remove(k); break; }
+    if(sections[i].notifyPending)
+        for(int k = 0; k < updateNotify.GetCount(); k++)
+            if(updateNotify[k] == &sections[i]) { updateNotify.Remove(k); break; }
+    bool hit = filtering && FilterRemoved(sections[i]);
+    SetTargetCy(sections[i], 0);
+    if(Section *p = sections[i].parent) {
+        p->childCount--;
+        nestedCount--;
     }
-    UpdateHeaderIndices();
-    RefreshLayout();
+    if(sections[i].hidden) hiddenCount--;
+    if(hotSection == i) hotSection = -1;
+    else if(hotSection > i) hotSection--;
+    if(pressedSection == i) pressedSection = -1;
+    else if(pressedSection > i) pressedSection--;
+    if(focusSection == i) focusSection = -1;
+    else if(focusSection > i) focusSection--;
+    sections.Remove(i);
+    GeometryChanged();
+
+    SectionsMoved(i);
+    if(hit)
+        UpdateFiltered(); // its ancestors may have no match left
+    if(enforceOne && sections.GetCount() > 0 && openCount == 0)
+        Open(0, false);
+    Relayout();
 }
 
 void AccordionCtrl::Clear() {
+    if(model) {
+        ClearModel();
+        return;
+    }
+    lru.Clear(); // nothing is released while the sections go
+    lruHead = lruCount = 0;
+    lruBytes = 0;
     for(int i = 0; i < sections.GetCount(); i++) {
         StopAnimation(i);
+        CancelAsync(sections[i]);
         if(sections[i].header) sections[i].header->Remove();
-        if(sections[i].body)   sections[i].body->Remove();
+        if(sections[i].body) {
+            sections[i].body->owner = nullptr;
+            sections[i].body->Remove();
+        }
     }
     sections.Clear();
+    shown.Clear();
+    remeasure.Clear();
+    reflow.Clear();
+    filterHits.Clear();
+    autoOpened.Clear();
+    updateKeeps.Clear();
+    updateNotify.Clear();
+    prewarmed.Clear();
+    prewarmTarget = nullptr;
+    KillTimeCallback(TIMEID_PREWARM);
+    targetTotal = hiddenCount = nestedCount = 0;
+    openBits.Clear();
+    lockBits.Clear();
+    openCount = lockOpenCount = 0;
+    keys.Clear();
+    keyOwner.Clear();
+    indexFrom = 0;
     hotSection = -1;
     pressedSection = -1;
-    RefreshLayout();
+    focusSection = -1;
+    GeometryChanged();
+    Relayout();
 }
 
-Ctrl&       AccordionCtrl::HeaderCtrl(int i) { ASSERT(i >= 0 && i < sections.GetCount()); return *sections[i].header; }
-ParentCtrl& AccordionCtrl::BodyCtrl(int i)   { ASSERT(i >= 0 && i < sections.GetCount()); return *sections[i].body; }
-bool        AccordionCtrl::IsOpen(int i) const { ASSERT(i >= 0 && i < sections.GetCount()); return sections[i].open; }
+Ctrl&       AccordionCtrl::HeaderCtrl(int i) { ASSERT(!model && i >= 0 && i < sections.GetCount()); return *sections[i].header; }
+ParentCtrl& AccordionCtrl::BodyCtrl(int i)   { ASSERT(!model && i >= 0 && i < sections.GetCount()); return GetBodyPane(i); }
+bool        AccordionCtrl::IsOpen(int i) const { ASSERT(i >= 0 && i < GetCount()); return model ? model->IsOpen(i) : openBits[i]; }
 
 void AccordionCtrl::Open(int i, bool animate) {
-    ASSERT(i >= 0 && i < sections.GetCount());
-    if(sections[i].open) return;
-    if(sections[i].lock == LOCKED_CLOSED) return; // cannot open
+    ASSERT(i >= 0 && i < GetCount());
+    TraceScope tr(*this, "Open", i);
+    if(model) { SetModelOpen(i, true); return; }
+    if(openBits[i]) return;
+    if(lockBits[i]) return; // locked closed
 
     if(WhenBeforeToggle(i)) return;
 
-    if(singleExpand) CloseOthers(i);
+    // Mark open first, so AtLeastOneOpen does not keep the others from closing
+    SetOpenFlag(i, true);
+    if(singleExpand) {
+        if(updateDepth) updateKeeps.GetAdd(sections[i].parent) = &sections[i]; // reconciled once in EndUpdate
+        else            CloseOthers(i);
+    }
 
-    sections[i].open = true;
-    int targetH = GetBodyMinHeight(i);
+    RealizeBody(i);
+    if(prewarmed.GetCount() || prewarmTarget)
+        ForgetPrewarm(sections[i]);
+    int targetH = BodyContentCy(i);  // measured after the factory ran (or cached by prewarming)
+    sections[i].lastBodyCy = targetH;
 
     if(animate && animEnabled && animOpenMs > 0)
         StartAnimation(i, targetH, animOpenMs);
     else {
-        sections[i].currentBodyCy = targetH;
-        sections[i].targetBodyCy  = targetH;
-        RefreshLayout();
+        StopAnimation(i);
+        SetBodyCy(i, targetH);
+        SetTargetCy(sections[i], targetH);
+        Relayout();
     }
-    WhenOpen(i);
+    NotifyState(i, true);
 }
 
 void AccordionCtrl::Close(int i, bool animate) {
-    ASSERT(i >= 0 && i < sections.GetCount());
-    if(!sections[i].open) return;
-    if(sections[i].lock == LOCKED_OPEN) return; // cannot close
+    ASSERT(i >= 0 && i < GetCount());
+    TraceScope tr(*this, "Close", i);
+    if(model) { SetModelOpen(i, false); return; }
+    if(!openBits[i]) return;
+    if(lockBits[i]) return; // locked open
 
-    if(enforceOne) {
-        int openCount = 0;
-        for(int j = 0; j < sections.GetCount(); j++)
-            if(sections[j].open) openCount++;
-        if(openCount <= 1) return;
-    }
+    if(enforceOne && openCount <= 1) return;
     if(WhenBeforeToggle(i)) return;
 
-    sections[i].open = false;
+    CancelAsync(sections[i]);
+    SetOpenFlag(i, false);
 
     if(animate && animEnabled && animCloseMs > 0)
         StartAnimation(i, 0, animCloseMs);
     else {
-        sections[i].currentBodyCy = 0;
-        sections[i].targetBodyCy  = 0;
-        RefreshLayout();
+        StopAnimation(i);
+        SetBodyCy(i, 0);
+        SetTargetCy(sections[i], 0);
+        Relayout();
     }
-    WhenClose(i);
+    NotifyState(i, false);
 }
 
 void AccordionCtrl::Toggle(int i, bool animate) {
-    ASSERT(i >= 0 && i < sections.GetCount());
-    if(sections[i].open) Close(i, animate);
-    else                 Open(i, animate);
+    ASSERT(i >= 0 && i < GetCount());
+    if(IsOpen(i)) Close(i, animate);
+    else          Open(i, animate);
+}
+
+Bits AccordionCtrl::GetOpenStates() const {
+    if(!model)
+        return clone(openBits);
+    Bits b;
+    for(int i = 0; i < GetCount(); i++)
+        if(model->IsOpen(i)) b.Set(i);
+    return b;
+}
+
+void AccordionCtrl::SetOpenStates(const Bits& open, bool animate) {
+    // Opens go first, so AtLeastOneOpen never blocks a close the new state allows;
+    // SingleExpand keeps the last opened section when the batch ends
+    Batch batch(*this);
+    int n = GetCount();
+    for(int i = 0; i < n; i++)
+        if(open[i] && !IsOpen(i)) Open(i, animate);
+    for(int i = 0; i < n; i++)
+        if(!open[i] && IsOpen(i)) Close(i, animate);
 }
 
 AccordionCtrl& AccordionCtrl::SingleExpand(bool b) {
     singleExpand = b;
-    if(b) {
-        int firstOpen = -1;
-        for(int i = 0; i < sections.GetCount(); i++)
-            if(sections[i].open) {
-                if(firstOpen < 0) firstOpen = i;
-                else Close(i, false);
-            }
-    }
+    if(b) ApplySingleExpand();
     return *this;
 }
 
+void AccordionCtrl::ApplySingleExpand() {
+    // The first unlocked open section of each sibling group closes the rest of the group
+    for(int i = 0; i < GetCount(); i++)
+        if(IsOpen(i) && !IsLocked(i))
+            CloseOthers(i);
+}
+
 AccordionCtrl& AccordionCtrl::AtLeastOneOpen(bool b) { enforceOne = b; if(b) EnsureAtLeastOneOpen(-1); return *this; }
-AccordionCtrl& AccordionCtrl::SetTitle(int i, const String& title) { ASSERT(i>=0&&i<sections.GetCount()); sections[i].title=title; RefreshSection(i); return *this; }
-AccordionCtrl& AccordionCtrl::SetHeaderAlign(int i, int align)     { ASSERT(i>=0&&i<sections.GetCount()); sections[i].align=align; RefreshSection(i); return *this; }
-AccordionCtrl& AccordionCtrl::UseDivider(int i, bool use)           { ASSERT(i>=0&&i<sections.GetCount()); sections[i].useDivider=use; RefreshSection(i); return *this; }
-AccordionCtrl& AccordionCtrl::SetIcons(Image c, Image e)            { iconClosed=c; iconOpened=e; Refresh(); return *this; }
+AccordionCtrl& AccordionCtrl::SetTitle(int i, const String& title) { ASSERT(!model&&i>=0&&i<sections.GetCount()); sections[i].title=title; sections[i].headerImg.Clear(); FilterChanged(i); RefreshSection(i); return *this; }
+AccordionCtrl& AccordionCtrl::SetHeaderAlign(int i, int align)     { ASSERT(!model&&i>=0&&i<sections.GetCount()); sections[i].align=align; sections[i].headerImg.Clear(); RefreshSection(i); return *this; }
+AccordionCtrl& AccordionCtrl::UseDivider(int i, bool use)           { ASSERT(!model&&i>=0&&i<sections.GetCount()); sections[i].useDivider=use; sections[i].headerImg.Clear(); RefreshSection(i); return *this; }
+AccordionCtrl& AccordionCtrl::SetIcons(Image c, Image e)            { iconClosed=c; iconOpened=e; InvalidateHeaders(); Refresh(); return *this; }
+AccordionCtrl& AccordionCtrl::CacheHeaders(bool on)                 { headerCache=on; InvalidateHeaders(); Refresh(); return *this; }
 AccordionCtrl& AccordionCtrl::SetAnimationMs(int ms)                { const_cast<Style*>(style)->animMs=max(0, ms); return *this; }
 
+AccordionCtrl& AccordionCtrl::SetKey(int i, const String& key) {
+    ASSERT(!model && i >= 0 && i < sections.GetCount());
+    Section& q = sections[i];
+    UnlinkKey(q);
+    q.key = key;
+    if(key.GetCount()) {
+        q.keyPos = keys.Put(key);
+        if(q.keyPos >= keyOwner.GetCount())
+            keyOwner.SetCount(q.keyPos + 1, nullptr);
+        keyOwner[q.keyPos] = &q;
+    }
+    return *this;
+}
+
+void AccordionCtrl::UnlinkKey(Section& s) {
+    if(s.keyPos < 0) return;
+    keys.Unlink(s.keyPos);
+    keyOwner[s.keyPos] = nullptr;
+    s.keyPos = -1;
+}
+
+int AccordionCtrl::FindSection(const String& key) const {
+    int q = keys.Find(key);
+    return q < 0 ? -1 : IndexOf(*keyOwner[q]);
+}
+
+int AccordionCtrl::IndexOf(const Section& s) const {
+    if(s.index >= indexFrom) { // positions from indexFrom on may have shifted since
+        for(int i = indexFrom; i < sections.GetCount(); i++)
+            const_cast<Section&>(sections[i]).index = i;
+        indexFrom = sections.GetCount();
+    }
+    ASSERT(&sections[s.index] == &s);
+    return s.index;
+}
+
+String AccordionCtrl::GetKey(int i) const {
+    ASSERT(!model && i >= 0 && i < sections.GetCount());
+    const Section& q = sections[i];
+    return q.key.GetCount() ? q.key : q.title;
+}
+
 void AccordionCtrl::Serialize(Stream& s) {
-    int version = 1;
+    enum { SF_OPEN = 1, SF_LOCKED = 2, SF_DIVIDER = 4 };
+
+    int version = 3;
     s % version;
+    if(s.IsLoading() && (version < 1 || version > 3)) {
+        s.LoadError();
+        return;
+    }
     s % singleExpand % enforceOne;
 
-    if(s.IsLoading()) {
-        int count; s % count;
-        Clear();
+    if(s.IsStoring()) {
+        int count = model ? 0 : sections.GetCount(); // model rows persist through the model itself
+        s / count;
         for(int i = 0; i < count; i++) {
-            String title; bool open; int align; bool useDivider;
-            s % title % open % align % useDivider;
-            AddSection(title);
-            sections[i].open = open;
-            sections[i].align = align;
-            sections[i].useDivider = useDivider;
-            sections[i].currentBodyCy = open ? GetBodyMinHeight(i) : 0;
-            sections[i].targetBodyCy = sections[i].currentBodyCy;
+            Section& q = sections[i];
+            String key = GetKey(i);
+            byte flags = (openBits[i] ? SF_OPEN : 0) | (lockBits[i] ? SF_LOCKED : 0) | (q.useDivider ? SF_DIVIDER : 0);
+            int cy = openBits[i] ? q.targetBodyCy : q.lastBodyCy;
+            s % key % q.title % flags / q.align / cy / q.depth;
+        }
+        return;
+    }
+
+    struct Saved {
+        String key, title;
+        byte   flags = 0;
+        int    align = ALIGN_LEFT;
+        int    cy = 0;
+        int    depth = 0;
+    };
+    Array<Saved> saved;
+    int count = 0;
+    if(version >= 2) s / count;
+    else             s % count;
+    if(count < 0) {
+        s.LoadError();
+        return;
+    }
+    for(int i = 0; i < count && !s.IsError(); i++) {
+        Saved& r = saved.Add();
+        if(version >= 2) {
+            s % r.key % r.title % r.flags / r.align / r.cy;
+            if(version >= 3) s / r.depth;
+        }
+        else {
+            bool open, useDivider;
+            s % r.title % open % r.align % useDivider;
+            r.key = r.title;
+            r.flags = (open ? SF_OPEN : 0) | (useDivider ? SF_DIVIDER : 0);
+        }
+    }
+    if(model || s.IsError()) return;
+
+    Batch batch(*this); // one layout pass for the whole restore
+    if(sections.IsEmpty()) {
+        Vector<int> level; // last section created at each depth
+        for(const Saved& r : saved) {
+            int depth = minmax(r.depth, 0, level.GetCount());
+            int i = depth ? AddSection(level[depth - 1], r.title) : AddSection(r.title);
+            level.SetCount(depth + 1);
+            level[depth] = i;
+            if(r.key != r.title) SetKey(i, r.key);
+            sections[i].align = r.align;
+            sections[i].useDivider = r.flags & SF_DIVIDER;
+        }
+    }
+
+    Index<String> titles; // sections without a key are matched by title, each one once
+    for(int i = 0; i < sections.GetCount(); i++) {
+        titles.Add(sections[i].title);
+        if(sections[i].key.GetCount()) titles.Unlink(i);
+    }
+    for(const Saved& r : saved) {
+        int i = FindSection(r.key);
+        if(i < 0 && (i = titles.Find(r.key)) >= 0)
+            titles.Unlink(i); // duplicate titles go to the next section of that name
+        if(i >= 0)
+            RestoreState(i, r.flags & SF_OPEN, r.flags & SF_LOCKED, r.cy);
+    }
+
+    // Saved state may come from a control with other modes or sections
+    if(singleExpand && openCount - lockOpenCount > 1)
+        ApplySingleExpand();
+    EnsureAtLeastOneOpen(-1);
+}
+
+void AccordionCtrl::RestoreState(int i, bool open, bool locked, int cy) {
+    Section& q = sections[i];
+    bool was_open = openBits[i];
+    StopAnimation(i);
+    SetLockFlag(i, false);
+    SetOpenFlag(i, open);
+    if(cy > 0) q.lastBodyCy = cy;
+
+    int h = 0;
+    if(open) {
+        if(q.factory && !q.bodyBuilt && cy > 0)
+            h = cy; // factory runs once the section scrolls into view (RealizeDeferred)
+        else {
+            RealizeBody(i);
+            h = q.lastBodyCy = BodyContentCy(i);
         }
-        RefreshLayout();
-    } else {
-        int count = sections.GetCount();
-        s % count;
-        for(int i = 0; i < count; i++)
-            s % sections[i].title % sections[i].open % sections[i].align % sections[i].useDivider;
     }
+    SetBodyCy(i, h);
+    SetTargetCy(q, h);
+    SetLockFlag(i, locked);
+    if(was_open != open)
+        NotifyState(i, open);
+    RefreshSection(i);
 }
 
 void AccordionCtrl::Paint(Draw& w) {
+    TraceScope tr(*this, "Paint");
+    StatScope st(statsOn, stats.paintCount, stats.paintUs);
+    int64 t0 = anims.GetCount() || reflow.GetCount() ? usecs() : 0; // charged to the animation frame budget
     Size sz = GetSize();
-    w.DrawRect(sz, SColorPaper());
+    Rect clip = w.GetPaintRect() & Rect(sz);
+    w.DrawRect(clip, SColorPaper());
 
     if(style->borderWidth > 0) {
         w.DrawRect(0, 0, sz.cx, style->borderWidth, style->borderColor);
@@ -293,85 +506,215 @@ void AccordionCtrl::Paint(Draw& w) {
         w.DrawRect(sz.cx - style->borderWidth, 0, style->borderWidth, sz.cy, style->borderColor);
     }
 
-    for(int i = 0; i < sections.GetCount(); i++) {
-        Section& s = sections[i];
-        bool hot = (i == hotSection);
-        bool pressed = (i == pressedSection);
-
-        ChPaint(w, s.headerRect, style->headerLook);
-        if(hot || pressed)
-            w.DrawRect(s.headerRect, style->headerBgHover);
-
-        // Icon: lock when locked; otherwise chevron
-        Image icon = (s.lock != UNLOCKED) ? iconLock : (s.open ? iconOpened : iconClosed);
-        if(!icon.IsEmpty())
-            w.DrawImage(s.iconRect.left, s.iconRect.top, icon);
-
-        Color ink = (hot || pressed) ? style->headerInkHover : style->headerInk;
-        int textX = s.iconRect.right + style->iconTextGap;
-        int textY = s.headerRect.top + (style->headerCy - GetTextSize(s.title, style->headerFont).cy) / 2;
-        w.DrawText(textX, textY, s.title, style->headerFont, ink);
-
-        if(s.useDivider && style->dividerThick > 0) {
-            int divX = s.headerRect.right - style->headerRPad - 1;
-            w.DrawRect(divX, s.headerRect.top + 4, style->dividerThick, style->headerCy - 8, style->dividerColor);
+    if(headerCache && headerCacheInk != SColorText()) { // Chameleon change
+        headerCacheInk = SColorText();
+        InvalidateHeaders();
+    }
+
+    // Only sections intersecting the paint clip are visited
+    UpdateGeometry();
+    int first = max(SectionAt(viewTop + clip.top - reflowMax), 0);
+    int last  = SectionAt(viewTop + clip.bottom - 1 + reflowMax);
+
+    for(int i = first; i <= last; i++) {
+        if(!model && sections[i].hidden) continue;
+        bool hot = (i == hotSection) || (i == pressedSection && pressedInside);
+        if(model)
+            PaintHeader(w, GetHeaderRect(i), model->GetTitle(i), model->IsOpen(i), model->IsLocked(i), false, hot);
+        else if(headerCache)
+            PaintCachedHeader(w, i, GetHeaderRect(i), hot);
+        else {
+            const Section& s = sections[i];
+            PaintHeader(w, GetHeaderRect(i), s.title, openBits[i], lockBits[i], s.useDivider, hot);
         }
 
-        if(s.currentBodyCy > 0)
-            ChPaint(w, s.bodyRect, style->bodyLook);
+        if(RowBodyCy(i) > 0) {
+            Rect br = GetBodyRect(i);
+            ChPaint(w, br, style->bodyLook);
+            if(!model && sections[i].async && sections[i].async->job)
+                PaintPlaceholder(w, br);
+            else if(!model && !sections[i].snapshot.IsEmpty()) {
+                w.Clip(br);
+                w.DrawImage(br.left, br.top, sections[i].snapshot);
+                w.End();
+            }
+        }
+    }
+
+    if(dragging && dropTarget >= 0 && dropTarget != pressedSection) { // drop position marker
+        Rect hr = GetHeaderRect(dropTarget);
+        int y = dropTarget < pressedSection ? hr.top : RowTop(SubtreeEnd(dropTarget)) - viewTop;
+        w.DrawRect(hr.left, y - DPI(1), hr.GetWidth(), DPI(2), SColorHighlight());
     }
+    if(t0)
+        animPaintUs += usecs(t0);
 }
 
-void AccordionCtrl::Layout() {
-    Size sz = GetSize();
-    int y = style->borderWidth;
-    int cx = sz.cx - 2 * style->borderWidth;
+void AccordionCtrl::PaintCachedHeader(Draw& w, int i, const Rect& r, bool hot) {
+    Section& s = sections[i];
+    bool open = openBits[i];
+    bool locked = lockBits[i];
+    int state = (hot ? 1 : 0) | (open ? 2 : 0) | (locked ? 4 : 0);
+    int64 key = ((int64)headerSerial << 32) | r.GetWidth();
+    if(!s.headerImg)
+        s.headerImg.Create();
+    Image& img = s.headerImg->img[state];
+    if(img.IsEmpty() || s.headerImg->key[state] != key) {
+        Size hsz = r.GetSize();
+        ImageDraw iw(hsz);
+        iw.DrawRect(hsz, SColorPaper());
+        PaintHeader(iw, hsz, s.title, open, locked, s.useDivider, hot);
+        img = iw;
+        s.headerImg->key[state] = key;
+    }
+    w.DrawImage(r.left, r.top, img);
+}
 
-    for(int i = 0; i < sections.GetCount(); i++) {
-        Section& s = sections[i];
+void AccordionCtrl::PaintHeader(Draw& w, const Rect& r, const String& title, bool open, bool locked,
+                                bool useDivider, bool hot) const
+{
+    Rect iconRect = GetIconRect(r);
+
+    ChPaint(w, r, style->headerLook);
+    if(hot)
+        w.DrawRect(r, style->headerBgHover);
+
+    // Icon: lock when locked; otherwise chevron
+    Image icon = GetIcon(locked ? ICON_LOCK : open ? ICON_OPENED : ICON_CLOSED);
+    if(!icon.IsEmpty())
+        w.DrawImage(iconRect.left, iconRect.top, icon);
+
+    Color ink = hot ? style->headerInkHover : style->headerInk;
+    int textX = iconRect.right + style->iconTextGap;
+    int textY = r.top + (style->headerCy - GetTextSize(title, style->headerFont).cy) / 2;
+    w.DrawText(textX, textY, title, style->headerFont, ink);
 
-        s.headerRect = RectC(style->borderWidth, y, cx, style->headerCy);
-        s.iconRect   = RectC(s.headerRect.left + style->headerLPad,
-                             s.headerRect.top + (style->headerCy - style->iconCx) / 2,
-                             style->iconCx, style->iconCx);
-        if(s.header) { s.header->SetRect(s.headerRect); s.header->index = i; }
+    if(useDivider && style->dividerThick > 0) {
+        int divX = r.right - style->headerRPad - 1;
+        w.DrawRect(divX, r.top + 4, style->dividerThick, style->headerCy - 8, style->dividerColor);
+    }
+}
 
-        y += style->headerCy;
+void AccordionCtrl::Layout() {
+    TraceScope tr(*this, "Layout");
+    StatScope st(statsOn, stats.layoutCount, stats.layoutUs);
+    KillTimeCallback(TIMEID_MEASURE);
+    if(remeasure.GetCount())
+        RemeasureBodies();
 
-        int bodyCy = s.currentBodyCy;
-        s.bodyRect = RectC(style->borderWidth, y, cx, bodyCy);
-        if(s.body) s.body->SetRect(s.bodyRect);
+    Size sz = GetSize();
+    int first, last;
+    do {
+        UpdateGeometry();
+        sb.SetLine(style->headerCy);
+        sb.SetPage(sz.cy);
+        sb.SetTotal(totalCy);
+        viewTop = sb.Get();
+        if(!IsNull(scrollTarget))
+            scrollTarget = minmax(scrollTarget, 0, max(0, totalCy - sz.cy));
+
+        // Position only the sections inside the viewport, hide the ones that left it
+        first = max(SectionAt(viewTop - reflowMax), 0);
+        last  = SectionAt(viewTop + sz.cy - 1 + reflowMax);
+    }
+    while(!model && RealizeDeferred(first, last)); // restored heights were replaced by measured ones
 
-        y += bodyCy + style->sectionVGap;
+    if(model) {
+        LayoutVirtual(first, last);
+        return;
+    }
+
+    int serial = ++layoutSerial;
+    Vector<Section*> nowShown;
+    placingBodies = true;
+
+    for(int i = first; i <= last; i++) {
+        Section& s = sections[i];
+        if(s.hidden) continue;
+        s.shownSerial = serial;
+        nowShown.Add(&s);
+
+        if(s.header) {
+            s.header->SetRect(GetHeaderRect(i));
+            s.header->index = i;
+            s.header->Show();
+        }
+        if(s.body) {
+            if(s.snapshot.IsEmpty()) {
+                s.body->SetRect(GetBodyRect(i));
+                s.body->Show(s.currentBodyCy > 0);
+            }
+            else
+                s.body->Hide(); // Paint reveals the snapshot instead
+        }
     }
+
+    for(Section* s : shown)
+        if(s->shownSerial != serial) {
+            if(s->header) s->header->Hide();
+            if(s->body)   s->body->Hide();
+            s->headerImg.Clear(); // cache memory stays bounded by the viewport
+        }
+    shown = pick(nowShown);
+    placingBodies = false;
 }
 
 bool AccordionCtrl::Key(dword key, int count) {
-    if(sections.GetCount() == 0) return false;
+    if(GetCount() == 0) return false;
 
-    int current = -1;
-    for(int i = 0; i < sections.GetCount(); i++)
-        if(sections[i].header && sections[i].header->HasFocusDeep()) { current = i; break; }
+    int current = focusSection;
+
+    auto focus = [&](int i) {
+        EnsureVisible(i, false);
+        if(Ctrl* h = GetHeaderPane(i))
+            h->SetFocus();
+        return true;
+    };
 
+    int next = -1;
     switch(key) {
-        case K_DOWN: if(current >= 0 && current < sections.GetCount() - 1) { sections[current + 1].header->SetFocus(); return true; } break;
-        case K_UP:   if(current > 0) { sections[current - 1].header->SetFocus(); return true; } break;
-        case K_HOME: sections[0].header->SetFocus(); return true;
-        case K_END:  sections[sections.GetCount() - 1].header->SetFocus(); return true;
+        case K_DOWN: if(current >= 0) next = NextShown(current + 1, 1); break;
+        case K_UP:   if(current > 0) next = NextShown(current - 1, -1); break;
+        case K_HOME: next = NextShown(0, 1); break;
+        case K_END:  next = NextShown(GetCount() - 1, -1); break;
         case K_SPACE:
         case K_ENTER:
             if(current >= 0) { Toggle(current, true); return true; }
             break;
     }
+    if(next >= 0) {
+        if(prewarm) SchedulePrewarm(next, 0);
+        return focus(next);
+    }
     return Ctrl::Key(key, count);
 }
 
+void AccordionCtrl::MouseWheel(Point, int zdelta, dword) {
+    if(smoothScroll) {
+        int base = IsNull(scrollTarget) ? viewTop : scrollTarget;
+        ScrollTo(base - zdelta * 3 * style->headerCy / 120, true);
+    }
+    else {
+        sb.Wheel(zdelta);
+        OnScroll();
+    }
+}
+
 void AccordionCtrl::MouseMove(Point p, dword) {
-    if(HasCapture()) {
-        int hit = HitTestHeader(p);
-        bool nowPressed = (hit == pressedSection);
-        if(pressedSection >= 0 && sections[pressedSection].pressed != nowPressed) {
-            sections[pressedSection].pressed = nowPressed;
+    if(HasCapture() && pressedSection >= 0) {
+        if(dragReorder && !model && !dragging && abs(p.y - dragStart.y) > DPI(4))
+            dragging = true;
+        if(dragging) {
+            int t = DragTarget(p);
+            if(t != dropTarget) {
+                dropTarget = t;
+                Refresh();
+            }
+            return;
+        }
+        bool inside = (HitTestHeader(p) == pressedSection);
+        if(inside != pressedInside) {
+            pressedInside = inside;
             RefreshSection(pressedSection);
         }
     }
@@ -379,7 +722,6 @@ void AccordionCtrl::MouseMove(Point p, dword) {
 
 void AccordionCtrl::MouseLeave() {
     if(hotSection >= 0 && !HasCapture()) {
-        sections[hotSection].hot = false;
         RefreshSection(hotSection);
         hotSection = -1;
     }
@@ -388,9 +730,23 @@ void AccordionCtrl::MouseLeave() {
 void AccordionCtrl::LeftUp(Point p, dword) {
     if(!HasCapture()) return;
     int hit = HitTestHeader(p);
+    if(pressedSection >= 0 && dragging) {
+        int from = pressedSection, to = dropTarget;
+        dragging = false;
+        dropTarget = -1;
+        pressedSection = -1;
+        pressedInside = false;
+        ReleaseCapture();
+        Refresh();
+        if(to >= 0 && to != from) {
+            MoveSection(from, to, animEnabled);
+            WhenReorder();
+        }
+        return;
+    }
     if(pressedSection >= 0) {
         bool inside = (hit == pressedSection);
-        sections[pressedSection].pressed = false;
+        pressedInside = false;
         RefreshSection(pressedSection);
         if(inside) Toggle(pressedSection, true);
         pressedSection = -1;
@@ -400,114 +756,477 @@ void AccordionCtrl::LeftUp(Point p, dword) {
 
 // --- HeaderPane -> owner ---
 void AccordionCtrl::OnHeaderLeftDown(int i) {
-    if(i < 0 || i >= sections.GetCount()) return;
+    if(i < 0 || i >= GetCount()) return;
     pressedSection = i;
-    sections[i].pressed = true;
+    pressedInside = true;
+    dragStart = GetMouseViewPos();
     RefreshSection(i);
     SetCapture();
 }
 
 void AccordionCtrl::OnHeaderMouseMove(int i) {
     if(i != hotSection) {
-        if(hotSection >= 0) { sections[hotSection].hot = false; RefreshSection(hotSection); }
+        if(hotSection >= 0) RefreshSection(hotSection);
         hotSection = i;
-        if(hotSection >= 0) { sections[hotSection].hot = true; RefreshSection(hotSection); }
+        if(hotSection >= 0) RefreshSection(hotSection);
+        if(prewarm && hotSection >= 0) SchedulePrewarm(hotSection, prewarmDwellMs);
     }
     // If user pressed, but moved out and released elsewhere, LeftUp handler resolves it.
 }
 
 void AccordionCtrl::OnHeaderMouseLeave(int i) {
     if(!HasCapture() && hotSection == i) {
-        sections[hotSection].hot = false;
         RefreshSection(hotSection);
         hotSection = -1;
+        if(!model && prewarmTarget && prewarmTarget == &sections[i]) { // did not dwell long enough
+            KillTimeCallback(TIMEID_PREWARM);
+            prewarmTarget = nullptr;
+        }
     }
 }
 
 int AccordionCtrl::HitTestHeader(Point p) const {
-    for(int i = 0; i < sections.GetCount(); i++)
-        if(sections[i].headerRect.Contains(p)) return i;
-    return -1;
+    int i = SectionAt(p.y + viewTop);
+    return i >= 0 && RowCy(i) > 0 && GetHeaderRect(i).Contains(p) ? i : -1;
 }
 
 int AccordionCtrl::GetBodyMinHeight(int i) const {
     ASSERT(i >= 0 && i < sections.GetCount());
+    TraceScope tr(*this, "Measure", i);
     const Section& s = sections[i];
     int maxBottom = 0;
-    if(s.body) for(Ctrl* c = s.body->GetFirstChild(); c; c = c->GetNext())
-        maxBottom = max(maxBottom, c->GetRect().bottom);
-    return max(0, maxBottom + 8);
+    if(s.body) for(Ctrl* c = s.body->GetFirstChild(); c; c = c->GetNext()) {
+        Rect r = c->GetRect();
+        maxBottom = max(maxBottom, measureMinSize ? r.top + c->GetMinSize().cy : r.bottom);
+    }
+    return max(0, maxBottom + style->bodyBottomPad);
 }
 
-void AccordionCtrl::StopAnimation(int i) { ASSERT(i>=0&&i<sections.GetCount()); sections[i].animating=false; sections[i].animTicket++; }
+int AccordionCtrl::BodyContentCy(int i) {
+    Section& s = sections[i];
+    if(s.async && s.async->job)
+        return s.async->placeholderCy;
+    if(s.heightDirty) {
+        s.contentCy = GetBodyMinHeight(i);
+        s.heightDirty = false;
+    }
+    return s.contentCy;
+}
 
-void AccordionCtrl::StartAnimation(int i, int targetHeight, int duration_ms) {
-    ASSERT(i >= 0 && i < sections.GetCount());
-    StopAnimation(i);
-    sections[i].animating   = true;
-    sections[i].targetBodyCy = targetHeight;
-    int ticket = ++sections[i].animTicket;
-    // Store duration in targetBodyCy high bits? Simpler: capture locally.
-    SetTimeCallback(16, [=] { AnimTick(i, ticket); }); // tick uses animOpen/Close based on sign of delta
-    // We’ll keep duration in a lambda-captured value by computing per step from current delta sign.
-    // See AnimTick below.
+void AccordionCtrl::InvalidateBodyHeight(int i) {
+    ASSERT(!model && i >= 0 && i < sections.GetCount());
+    BodyChanged(&sections[i]);
+}
+
+AccordionCtrl& AccordionCtrl::MeasureMinSize(bool on) {
+    measureMinSize = on;
+    for(int i = 0; i < sections.GetCount(); i++)
+        BodyChanged(&sections[i]);
+    return *this;
+}
+
+void AccordionCtrl::BodyChanged(Section *s) {
+    if(!s || placingBodies) return;
+    if(s->heightDirty) return; // not measured yet or already queued
+    s->heightDirty = true;
+    remeasure.Add(s);
+    if(!ExistsTimeCallback(TIMEID_MEASURE))
+        SetTimeCallback(0, [=] { Relayout(); }, TIMEID_MEASURE);
+}
+
+bool AccordionCtrl::StateHook(Ctrl *ctrl, int reason) {
+    // Only moves/resizes of direct body children change a measured height
+    if(reason == POSITION)
+        if(BodyPane *body = dynamic_cast<BodyPane *>(ctrl->GetParent()))
+            if(body->owner)
+                body->owner->BodyChanged(body->section);
+    return false;
 }
 
-void AccordionCtrl::AnimTick(int i, int ticket) {
-    if(i < 0 || i >= sections.GetCount()) return;
-    if(sections[i].animTicket != ticket)  return;
+bool AccordionCtrl::RemeasureBodies() {
+    bool changed = false;
+    for(Section *s : remeasure) {
+        int i = IndexOf(*s);
+        int cy = BodyContentCy(i);
+        if(!openBits[i]) continue; // closed sections use the cached height when they open
+        s->lastBodyCy = cy;
+        if(s->animating)
+            SetTargetCy(*s, cy); // the running open animation heads for the new height
+        else
+        if(cy != s->currentBodyCy) {
+            SetBodyCy(i, cy);
+            SetTargetCy(*s, cy);
+            changed = true;
+        }
+    }
+    remeasure.Clear();
+    return changed;
+}
 
+void AccordionCtrl::StopAnimation(int i) {
+    ASSERT(i >= 0 && i < sections.GetCount());
     Section& s = sections[i];
-    int delta = s.targetBodyCy - s.currentBodyCy;
+    if(!s.animating) return;
+    s.animating = false;
+    s.snapshot = Image();
+    for(int j = 0; j < anims.GetCount(); j++)
+        if(anims[j] == &s) { anims.Remove(j); break; }
+    if(anims.IsEmpty() && reflow.IsEmpty())
+        KillTimeCallback(TIMEID_ANIM);
+    if(s.lruStamp) // a closing body the budget skipped
+        EnforceBodyBudget();
+}
 
-    if(abs(delta) <= 2) {
-        s.currentBodyCy = s.targetBodyCy;
-        s.animating = false;
-        RefreshLayout();
+void AccordionCtrl::StartAnimation(int i, int targetHeight, int duration_ms) {
+    ASSERT(i >= 0 && i < sections.GetCount());
+    TraceScope tr(*this, "StartAnimation", i);
+    Section& s = sections[i];
+    SetTargetCy(s, targetHeight);
+    s.animDuration = max(1, duration_ms);
+    s.animStart = msecs();
+    s.animFrom = s.currentBodyCy; // a reversed animation starts where the previous one is
+    s.animFresh = true;
+    Refresh(GetHeaderRect(i)); // chevron; frames that blit only repaint the body
+    if(animSnapshot && s.snapshot.IsEmpty())
+        TakeSnapshot(i, max(targetHeight, s.currentBodyCy));
+    if(!s.animating) {
+        s.animating = true;
+        anims.Add(&s);
+    }
+    StartClock();
+}
+
+void AccordionCtrl::StartClock() {
+    // One periodic clock drives every animating section of this control
+    if(!ExistsTimeCallback(TIMEID_ANIM)) {
+        animLastMs = msecs();
+        animPaintUs = 0;
+        animSkip = animOverRun = 0;
+        SetTimeCallback(-ANIM_FRAME_MS, [=] { AnimFrame(); }, TIMEID_ANIM);
+    }
+}
+
+void AccordionCtrl::AnimFrame() {
+    TraceScope tr(*this, "AnimTick");
+    int now = msecs();
+    int elapsed = max(1, now - animLastMs);
+    animLastMs = now;
+    if(statsOn)
+        stats.animExpected += max(1, (elapsed + ANIM_FRAME_MS / 2) / ANIM_FRAME_MS);
+
+    // The previous frame's Layout+Paint decides whether this one is drawn at all; positions
+    // depend on time only, so dropped ticks do not stretch the animation
+    if(animSkip > 0) {
+        animSkip--;
+        if(statsOn) stats.animDropped++;
         return;
     }
+    if(statsOn) stats.animFrames++; // delivered
+    int64 t0 = usecs();
+
+    // With a single section changing height, everything below it only moves. Not so on the
+    // first frame (the open/close that started it may have moved rows, e.g. a parent's
+    // children) nor for a parent, whose children move along with its body.
+    int blit = -1, blitBottom = 0, blitTotal = 0;
+    if(!model && anims.GetCount() == 1 && reflow.IsEmpty() && !dragging &&
+       !anims[0]->animFresh && anims[0]->childCount == 0) {
+        blit = IndexOf(*anims[0]);
+        blitBottom = RowTop(blit + 1) - viewTop;
+        blitTotal = totalCy;
+    }
+
+    bool changed = false;
+    bool closed = false; // a body the budget skipped while it was closing can go now
+    for(int j = 0; j < anims.GetCount();) {
+        Section& s = *anims[j];
+        int i = IndexOf(s);
+        s.animFresh = false;
+        double t = double(now - s.animStart) / s.animDuration;
+        if(t >= 1) {
+            closed = closed || (s.targetBodyCy == 0 && s.lruStamp);
+            SetBodyCy(i, s.targetBodyCy);
+            s.animating = false;
+            s.snapshot = Image(); // Layout below places and shows the real children once
+            anims.Remove(j);
+        }
+        else {
+            SetBodyCy(i, s.animFrom + int((s.targetBodyCy - s.animFrom) * Ease(max(t, 0.0))));
+            j++;
+        }
+        changed = true;
+    }
+
+    if(closed)
+        EnforceBodyBudget();
 
-    // Choose duration by direction
-    const int duration_ms = (delta > 0 ? animOpenMs : animCloseMs);
-    double t = 16.0 / max(1, duration_ms);   // fraction per frame
-    s.currentBodyCy += int(delta * t);
+    if(reflow.GetCount()) {
+        double t = double(now - reflowStart) / max(style->animMs, 1);
+        double left = t >= 1 ? 0 : 1 - Ease(max(t, 0.0));
+        reflowMax = 0;
+        for(Section *s : reflow) {
+            s->shift = int(s->shiftFrom * left);
+            reflowMax = max(reflowMax, abs(s->shift));
+        }
+        if(left <= 0) {
+            for(Section *s : reflow)
+                s->shiftFrom = 0;
+            reflow.Clear();
+        }
+        changed = true;
+    }
 
-    RefreshLayout();
-    SetTimeCallback(16, [=] { AnimTick(i, ticket); });
+    if(anims.IsEmpty() && reflow.IsEmpty())
+        KillTimeCallback(TIMEID_ANIM);
+
+    if(changed) {
+        if(blit < 0 || !ScrollBelow(blit, blitBottom, blitTotal)) {
+            Layout();
+            Refresh();
+        }
+        if(reportAnimated) SizeChanged();
+    }
+
+    int64 cost = usecs(t0) + animPaintUs;
+    animPaintUs = 0;
+    if(animBudgetMs > 0 && cost > animBudgetMs * 1000) {
+        if(statsOn) stats.animOverBudget++;
+        if(++animOverRun >= 3)
+            SnapAnimations();
+        else
+            animSkip = min(int(cost / (animBudgetMs * 1000)), 4);
+    }
+    else
+        animOverRun = 0;
+}
+
+double AccordionCtrl::Ease(double t) const {
+    switch(animEasing) {
+    case EASE_LINEAR:
+        return t;
+    case EASE_IN_OUT:
+        return t < 0.5 ? 4 * t * t * t : 1 - 4 * (1 - t) * (1 - t) * (1 - t);
+    default:
+        return 1 - (1 - t) * (1 - t) * (1 - t);
+    }
+}
+
+void AccordionCtrl::SnapAnimations() {
+    TraceScope tr(*this, "Snap");
+    if(statsOn) stats.animSnapped++;
+    for(Section *s : anims) {
+        SetBodyCy(IndexOf(*s), s->targetBodyCy);
+        s->animating = false;
+        s->snapshot = Image();
+    }
+    anims.Clear();
+    for(Section *s : reflow)
+        s->shiftFrom = s->shift = 0;
+    reflow.Clear();
+    reflowMax = 0;
+    animSkip = animOverRun = 0;
+    KillTimeCallback(TIMEID_ANIM);
+    if(lruCount)
+        EnforceBodyBudget(); // closing bodies the budget skipped
+    Layout();
+    Refresh();
+    if(reportAnimated) SizeChanged();
+}
+
+AccordionCtrl& AccordionCtrl::SetAnimationEasing(int easing) {
+    animEasing = easing;
+    return *this;
+}
+
+AccordionCtrl& AccordionCtrl::SetAnimationBudget(int ms) {
+    animBudgetMs = max(0, ms);
+    return *this;
+}
+
+bool AccordionCtrl::ScrollBelow(int i, int bottom, int oldTotal) {
+    // The pixels below the end of row i are scrolled by its height change; ScrollView
+    // invalidates the strip it uncovers and Paint only has to draw that and the body of i.
+    // A shrinking row pulls them up from the old bottom into the new one.
+    UpdateGeometry();
+    Size sz = GetSize();
+    int dy = totalCy - oldTotal;
+    if((totalCy > sz.cy) != (oldTotal > sz.cy) || viewTop > max(0, totalCy - sz.cy))
+        return false; // the scroll bar shows/hides or the view gets clamped: everything moves
+    TraceScope tr(*this, "ScrollBlit", i);
+    int bw = style->borderWidth;
+    Rect r(bw, max(min(bottom, bottom + dy), bw), sz.cx - bw, sz.cy - bw);
+    if(dy && r.top < r.bottom)
+        ScrollView(r, 0, dy);
+    Layout(); // children below move by the same dy as the scrolled pixels
+    Refresh(GetBodyRect(i));
+    return true;
+}
+
+void AccordionCtrl::TakeSnapshot(int i, int cy) {
+    TraceScope tr(*this, "Snapshot", i);
+    Section& s = sections[i];
+    Rect br = GetBodyRect(i);
+    int cx = br.GetWidth();
+    if(!s.body || cy <= 0 || cx <= 0) return;
+
+    // Lay the body out once at its final size and render it (with the body look) into an image
+    placingBodies = true;
+    s.body->SetRect(RectC(br.left, br.top, cx, cy));
+    ImageDraw iw(cx, cy);
+    ChPaint(iw, Size(cx, cy), style->bodyLook);
+    s.body->Show();
+    s.body->DrawCtrl(iw);
+    s.body->Hide();
+    placingBodies = false;
+    s.snapshot = iw;
 }
 
 void AccordionCtrl::EnsureAtLeastOneOpen(int skip) {
     if(!enforceOne) return;
     bool anyOpen = false;
-    for(int i = 0; i < sections.GetCount(); i++)
-        if(i != skip && sections[i].open) { anyOpen = true; break; }
-    if(!anyOpen && sections.GetCount() > 0) {
-        int toOpen = (skip == 0 && sections.GetCount() > 1) ? 1 : 0;
+    if(!model)
+        anyOpen = openCount - (skip >= 0 && openBits[skip]) > 0;
+    else
+        for(int i = 0; i < GetCount(); i++)
+            if(i != skip && IsOpen(i)) { anyOpen = true; break; }
+    if(!anyOpen && GetCount() > 0) {
+        int toOpen = (skip == 0 && GetCount() > 1) ? 1 : 0;
         Open(toOpen, false);
     }
 }
 
 void AccordionCtrl::CloseOthers(int keep) {
-    for(int i = 0; i < sections.GetCount(); i++) {
+    if(!model && nestedCount) {
+        // Siblings of 'keep' only: walk the parent's children subtree by subtree
+        Section *p = keep >= 0 ? sections[keep].parent : nullptr;
+        int pi = p ? IndexOf(*p) : -1;
+        int end = p ? SubtreeEnd(pi) : sections.GetCount();
+        for(int j = pi + 1; j < end; j = SubtreeEnd(j))
+            if(j != keep && openBits[j] && !lockBits[j])
+                Close(j, false);
+        return;
+    }
+    if(!model) {
+        // Stop once every closable open section has been visited
+        int closable = openCount - lockOpenCount;
+        if(keep >= 0 && openBits[keep] && !lockBits[keep]) closable--;
+        for(int i = 0; i < sections.GetCount() && closable > 0; i++)
+            if(i != keep && openBits[i] && !lockBits[i]) {
+                Close(i, false);
+                closable--;
+            }
+        return;
+    }
+    for(int i = 0; i < GetCount(); i++) {
         if(i == keep) continue;
-        if(sections[i].open && sections[i].lock != LOCKED_OPEN)
+        if(IsOpen(i) && !IsLocked(i))
             Close(i, false);
     }
 }
 
+bool AccordionCtrl::HasOpenSibling(int i) const {
+    if(!nestedCount)
+        return openCount - openBits[i] > 0;
+    // Same walk as CloseOthers
+    const Section *p = sections[i].parent;
+    int pi = p ? IndexOf(*p) : -1;
+    int end = p ? SubtreeEnd(pi) : sections.GetCount();
+    for(int j = pi + 1; j < end; j = SubtreeEnd(j))
+        if(j != i && openBits[j])
+            return true;
+    return false;
+}
+
 void AccordionCtrl::RefreshSection(int i) {
-    if(i >= 0 && i < sections.GetCount()) {
-        Refresh(sections[i].headerRect);
-        Refresh(sections[i].bodyRect);
+    if(updateDepth) {
+        updatePending = true;
+        return;
+    }
+    if(i >= 0 && i < GetCount()) {
+        UpdateGeometry();
+        Refresh(GetHeaderRect(i));
+        Refresh(GetBodyRect(i));
     }
 }
 
-void AccordionCtrl::UpdateHeaderIndices() {
-    for(int i = 0; i < sections.GetCount(); i++)
-        if(sections[i].header) {
-            sections[i].header->owner = this;
-            sections[i].header->index = i;
+void AccordionCtrl::Relayout() {
+    if(updateDepth) {
+        updatePending = true;
+        return;
+    }
+    Layout();
+    Refresh();
+    SizeChanged();
+}
+
+void AccordionCtrl::NotifyState(int i, bool open) {
+    if(updateDepth) {
+        // Sections are kept by pointer: inserts, removes and moves may follow in the batch
+        if(model)
+            updateChanged.FindAdd(i);
+        else if(!sections[i].notifyPending) {
+            sections[i].notifyPending = true;
+            updateNotify.Add(&sections[i]);
+        }
+        return;
+    }
+    if(open) WhenOpen(i);
+    else     WhenClose(i);
+    if(WhenStateChanged) {
+        Vector<int> changed;
+        changed.Add(i);
+        WhenStateChanged(changed);
+    }
+}
+
+void AccordionCtrl::EndUpdate() {
+    ASSERT(updateDepth > 0);
+    if(updateDepth > 1) {
+        updateDepth--;
+        return;
+    }
+
+    // Still counted as updating, so the closes below join the batch
+    // Every sibling group opened into keeps its last opened section
+    int keep = updateKeep;
+    updateKeep = -1;
+    if(singleExpand && keep >= 0 && keep < GetCount() && IsOpen(keep))
+        CloseOthers(keep);
+    Vector<Section*> keeps;
+    for(int k = 0; k < updateKeeps.GetCount(); k++)
+        keeps.Add(updateKeeps[k]);
+    updateKeeps.Clear();
+    for(Section *s : keeps) {
+        int i = IndexOf(*s);
+        if(singleExpand && openBits[i])
+            CloseOthers(i);
+    }
+    updateDepth = 0;
+
+    if(updatePending) {
+        updatePending = false;
+        Layout();
+        Refresh();
+        SizeChanged();
+    }
+    if(updateChanged.GetCount() || updateNotify.GetCount()) {
+        Vector<int> changed;
+        for(int k = 0; k < updateChanged.GetCount(); k++)
+            if(updateChanged[k] < GetCount()) // a ModelChanged in the batch may have dropped it
+                changed.Add(updateChanged[k]);
+        updateChanged.Clear();
+        for(Section *s : updateNotify) {
+            s->notifyPending = false;
+            changed.Add(IndexOf(*s));
+        }
+        updateNotify.Clear();
+        Sort(changed);
+        for(int i : changed) {
+            if(IsOpen(i)) WhenOpen(i);
+            else          WhenClose(i);
         }
+        if(changed.GetCount())
+            WhenStateChanged(changed);
+    }
 }
 
 AccordionCtrl& AccordionCtrl::SetAnimationEnabled(bool on) {
@@ -521,63 +1240,405 @@ AccordionCtrl& AccordionCtrl::SetAnimationDurations(int open_ms, int close_ms) {
     return *this;
 }
 
+AccordionCtrl& AccordionCtrl::SetAnimationSnapshot(bool on) {
+    animSnapshot = on;
+    return *this;
+}
+
 AccordionCtrl& AccordionCtrl::SetLocked(int i, bool lock) {
-    ASSERT(i >= 0 && i < sections.GetCount());
-    Section& s = sections[i];
-    const bool was_open = s.open;
+    ASSERT(!model && i >= 0 && i < sections.GetCount());
+    const bool was_open = openBits[i];
 
     // Lock in current state only (no auto open/close here)
-    s.lock = lock ? (was_open ? LOCKED_OPEN : LOCKED_CLOSED) : UNLOCKED;
+    SetLockFlag(i, lock);
 
     // Single-open reconciliation:
-    // If we just UNLOCKED an OPEN section and another section is open,
+    // If we just UNLOCKED an OPEN section and one of its siblings is open,
     // close this one to restore the single-open invariant.
-    if(!lock && singleExpand && was_open) {
-        bool other_open = false;
-        for(int j = 0; j < sections.GetCount(); ++j) {
-            if(j != i && sections[j].open) { other_open = true; break; }
-        }
-        if(other_open)
-            Close(i, /*animate*/ true);
-    }
+    if(!lock && singleExpand && was_open && HasOpenSibling(i))
+        Close(i, /*animate*/ true);
 
     RefreshSection(i);
     return *this;
 }
 
 AccordionCtrl& AccordionCtrl::LockOpen(int i, bool lock) {
-    ASSERT(i >= 0 && i < sections.GetCount());
-    sections[i].lock = lock ? LOCKED_OPEN : UNLOCKED;
-    if(lock) { sections[i].open = true; sections[i].currentBodyCy = GetBodyMinHeight(i); sections[i].targetBodyCy = sections[i].currentBodyCy; }
-    RefreshLayout();
+    ASSERT(!model && i >= 0 && i < sections.GetCount());
+    SetLockFlag(i, lock);
+    if(lock) { StopAnimation(i); SetOpenFlag(i, true); RealizeBody(i); SetBodyCy(i, BodyContentCy(i)); SetTargetCy(sections[i], sections[i].currentBodyCy); }
+    Relayout();
     return *this;
 }
 
 AccordionCtrl& AccordionCtrl::LockClosed(int i, bool lock) {
-    ASSERT(i >= 0 && i < sections.GetCount());
-    sections[i].lock = lock ? LOCKED_CLOSED : UNLOCKED;
-    if(lock) { sections[i].open = false; sections[i].currentBodyCy = 0; sections[i].targetBodyCy = 0; }
-    RefreshLayout();
+    ASSERT(!model && i >= 0 && i < sections.GetCount());
+    SetLockFlag(i, lock);
+    if(lock) { StopAnimation(i); SetOpenFlag(i, false); SetBodyCy(i, 0); SetTargetCy(sections[i], 0); }
+    Relayout();
     return *this;
 }
 
 bool AccordionCtrl::IsLocked(int i) const {
-    ASSERT(i >= 0 && i < sections.GetCount());
-    return sections[i].lock != UNLOCKED;
+    ASSERT(i >= 0 && i < GetCount());
+    return model ? model->IsLocked(i) : lockBits[i];
+}
+
+void AccordionCtrl::SetOpenFlag(int i, bool open) {
+    if(openBits[i] == open) return;
+    openBits.Set(i, open);
+    int d = open ? 1 : -1;
+    openCount += d;
+    if(lockBits[i]) lockOpenCount += d;
+    if(sections[i].childCount)
+        UpdateSubtree(i);
+    if(maxBodies || maxBodyBytes) {
+        if(open) BodyOpened(sections[i]);
+        else     BodyClosed(sections[i]);
+    }
+}
+
+int AccordionCtrl::GetParent(int i) const {
+    ASSERT(!model && i >= 0 && i < sections.GetCount());
+    const Section *p = sections[i].parent;
+    return p ? IndexOf(*p) : -1;
+}
+
+int AccordionCtrl::GetDepth(int i) const {
+    ASSERT(!model && i >= 0 && i < sections.GetCount());
+    return sections[i].depth;
+}
+
+int AccordionCtrl::GetChildCount(int i) const {
+    ASSERT(!model && i >= 0 && i < sections.GetCount());
+    return sections[i].childCount;
+}
+
+int AccordionCtrl::SubtreeEnd(int i) const {
+    int depth = sections[i].depth;
+    int j = i + 1;
+    if(sections[i].childCount)
+        while(j < sections.GetCount() && sections[j].depth > depth)
+            j++;
+    return j;
+}
+
+void AccordionCtrl::SetHidden(int i, bool hide) {
+    Section& s = sections[i];
+    if(s.hidden == hide) return;
+    // The row keeps its body height, only its contribution to the offsets goes to/from zero
+    int cy = FullRowCy(i);
+    if(!geomDirty) {
+        rows.Add(i, hide ? -cy : cy);
+        totalCy += hide ? -cy : cy;
+    }
+    targetTotal += hide ? -s.targetBodyCy : s.targetBodyCy;
+    hiddenCount += hide ? 1 : -1;
+    s.hidden = hide;
+}
+
+void AccordionCtrl::SetCollapsed(int i, bool c) {
+    Section& s = sections[i];
+    s.collapsed = c;
+    SetHidden(i, c || s.filtered);
+}
+
+void AccordionCtrl::UpdateSubtree(int i) {
+    // Only the subtree of i changes; closed children keep their own descendants hidden
+    int end = SubtreeEnd(i);
+    bool show = !sections[i].collapsed && openBits[i];
+    for(int j = i + 1; j < end;) {
+        SetCollapsed(j, !show);
+        if(show && !openBits[j]) {
+            int e = SubtreeEnd(j);
+            while(++j < e)
+                SetCollapsed(j, true);
+        }
+        else
+            j++;
+    }
+}
+
+int AccordionCtrl::NextShown(int i, int dir) const {
+    for(; i >= 0 && i < GetCount(); i += dir)
+        if(model || !sections[i].hidden)
+            return i;
+    return -1;
+}
+
+void AccordionCtrl::SetLockFlag(int i, bool lock) {
+    if(lockBits[i] == lock) return;
+    lockBits.Set(i, lock);
+    if(openBits[i]) lockOpenCount += lock ? 1 : -1;
+}
+
+// Shifted a dword at a time, each chunk is read whole before it is written back
+static void ShiftBitsUp(Bits& b, int at, int n) // [at, n - 1) -> [at + 1, n), bit at cleared
+{
+    for(int k = n - 1; k > at;) {
+        int c = min(k - at, 32);
+        k -= c;
+        b.Set(k + 1, b.Get(k, c), c);
+    }
+    b.Set(at, false);
+}
+
+static void ShiftBitsDown(Bits& b, int at, int n) // [at + 1, n) -> [at, n - 1), bit n - 1 cleared
+{
+    for(int k = at; k < n - 1;) {
+        int c = min(n - 1 - k, 32);
+        b.Set(k, b.Get(k + 1, c), c);
+        k += c;
+    }
+    b.Set(n - 1, false);
+}
+
+void AccordionCtrl::InsertStateBits(int at) {
+    int n = sections.GetCount();
+    ShiftBitsUp(openBits, at, n);
+    ShiftBitsUp(lockBits, at, n);
+}
+
+void AccordionCtrl::RemoveStateBits(int i) {
+    // Only the counts; SetOpenFlag would hand a removed open section to the body budget
+    int n = sections.GetCount();
+    if(openBits[i]) {
+        openCount--;
+        if(lockBits[i]) lockOpenCount--;
+    }
+    ShiftBitsDown(openBits, i, n);
+    ShiftBitsDown(lockBits, i, n);
 }
 
 AccordionCtrl& AccordionCtrl::OpenAll(bool animate) {
-    for(int i = 0; i < sections.GetCount(); i++)
-        if(sections[i].lock != LOCKED_CLOSED) Open(i, animate);
+    Batch batch(*this);
+    for(int i = 0; i < GetCount(); i++)
+        if(!IsLocked(i)) Open(i, animate);
     return *this;
 }
 
 AccordionCtrl& AccordionCtrl::CloseAll(bool animate) {
-    for(int i = 0; i < sections.GetCount(); i++)
-        if(sections[i].lock != LOCKED_OPEN) Close(i, animate);
+    Batch batch(*this);
+    for(int i = 0; i < GetCount(); i++)
+        if(!IsLocked(i)) Close(i, animate);
+    return *this;
+}
+
+// --- Viewport ---
+AccordionCtrl& AccordionCtrl::ReportAnimatedSize(bool on) {
+    reportAnimated = on;
+    SizeChanged();
+    return *this;
+}
+
+int AccordionCtrl::GetReportedCy() const {
+    if(model || reportAnimated) {
+        UpdateGeometry();
+        return totalCy;
+    }
+    int n = sections.GetCount() - hiddenCount;
+    return 2 * style->borderWidth + n * (style->headerCy + style->sectionVGap) + targetTotal;
+}
+
+Size AccordionCtrl::GetMinSize() const {
+    int cx = 2 * style->borderWidth + style->headerLPad + DPI(style->iconCx) + style->iconTextGap + style->headerRPad;
+    return AddFrameSize(cx, GetReportedCy());
+}
+
+Size AccordionCtrl::GetStdSize() const {
+    Size sz = GetMinSize();
+    sz.cx = max(sz.cx, DPI(200));
+    return sz;
+}
+
+void AccordionCtrl::SizeChanged() {
+    int cy = GetReportedCy();
+    if(cy != reportedCy) {
+        reportedCy = cy;
+        RefreshParentLayout();
+    }
+}
+
+void AccordionCtrl::SetBodyCy(int i, int cy) {
+    int& cur = model ? vbody[i] : sections[i].currentBodyCy;
+    if(cur == cy) return;
+    // Only offsets from i onward move; the Fenwick update is O(log N)
+    if(!geomDirty && RowCy(i) > 0) {
+        rows.Add(i, cy - cur);
+        totalCy += cy - cur;
+    }
+    cur = cy;
+}
+
+void AccordionCtrl::UpdateGeometry() const {
+    if(!geomDirty) return;
+    rows.Build(GetCount(), [&](int i) { return RowCy(i); });
+    totalCy = rows.total + 2 * style->borderWidth;
+    geomDirty = false;
+}
+
+int AccordionCtrl::SectionAt(int y) const {
+    int n = GetCount();
+    y -= style->borderWidth;
+    if(n == 0 || y < 0) return -1;
+    UpdateGeometry();
+    return min(rows.Find(y), n - 1);
+}
+
+Rect AccordionCtrl::GetHeaderRect(int i) const {
+    int indent = model ? 0 : sections[i].depth * style->indentCx;
+    int shift  = model ? 0 : sections[i].shift;
+    return RectC(style->borderWidth + indent, RowTop(i) - viewTop + shift,
+                 GetSize().cx - 2 * style->borderWidth - indent, style->headerCy);
+}
+
+Rect AccordionCtrl::GetBodyRect(int i) const {
+    int indent = model ? 0 : sections[i].depth * style->indentCx;
+    int shift  = model ? 0 : sections[i].shift;
+    return RectC(style->borderWidth + indent, RowTop(i) - viewTop + style->headerCy + shift,
+                 GetSize().cx - 2 * style->borderWidth - indent, RowBodyCy(i));
+}
+
+Rect AccordionCtrl::GetIconRect(const Rect& header) const {
+    int cx = DPI(style->iconCx); // matches the rasterized default icons
+    return RectC(header.left + style->headerLPad, header.top + (style->headerCy - cx) / 2, cx, cx);
+}
+
+AccordionCtrl& AccordionCtrl::ScrollToSection(int i, bool smooth) {
+    ASSERT(i >= 0 && i < GetCount());
+    UpdateGeometry();
+    ScrollTo(RowTop(i) - style->borderWidth, smooth);
     return *this;
 }
 
+AccordionCtrl& AccordionCtrl::EnsureVisible(int i, bool smooth) {
+    ASSERT(i >= 0 && i < GetCount());
+    UpdateGeometry();
+    int page = GetSize().cy;
+    int bodyCy = model ? vbody[i] : max(sections[i].currentBodyCy, sections[i].targetBodyCy);
+    int y0 = RowTop(i);
+    int y1 = y0 + min(style->headerCy + bodyCy, page);
+    int pos = viewTop;
+    if(y0 < pos)             pos = y0;
+    else if(y1 > pos + page) pos = y1 - page;
+    if(pos != viewTop)
+        ScrollTo(pos, smooth);
+    return *this;
+}
+
+AccordionCtrl& AccordionCtrl::SetSmoothScroll(bool on) {
+    smoothScroll = on;
+    return *this;
+}
+
+void AccordionCtrl::ScrollTo(int pos, bool smooth) {
+    pos = minmax(pos, 0, max(0, totalCy - GetSize().cy));
+    if(smooth && pos != viewTop) {
+        scrollTarget = pos;
+        SetTimeCallback(16, [=] { ScrollTick(); }, TIMEID_SCROLL);
+        return;
+    }
+    KillTimeCallback(TIMEID_SCROLL);
+    scrollTarget = Null;
+    sb.Set(pos);
+    OnScroll();
+}
+
+void AccordionCtrl::ScrollTick() {
+    if(IsNull(scrollTarget)) return;
+    int delta = scrollTarget - viewTop;
+    if(abs(delta) <= 2) {
+        ScrollTo(scrollTarget, false);
+        return;
+    }
+    sb.Set(viewTop + delta / 3 + (delta > 0 ? 1 : -1));
+    OnScroll();
+    SetTimeCallback(16, [=] { ScrollTick(); }, TIMEID_SCROLL);
+}
+
+Ctrl* AccordionCtrl::GetHeaderPane(int i) {
+    if(!model)
+        return ~sections[i].header;
+    for(Slot& q : slots)
+        if(q.row == i) return &q.header;
+    return nullptr;
+}
+
+AccordionCtrl::BodyPane& AccordionCtrl::GetBodyPane(int i) {
+    Section& s = sections[i];
+    if(!s.body) {
+        s.body.Create<BodyPane>();
+        s.body->owner = this;
+        s.body->section = &s;
+        s.body->Hide();
+        Add(*s.body);
+    }
+    return *s.body;
+}
+
+void AccordionCtrl::RealizeBody(int i) {
+    Section& s = sections[i];
+    BodyPane& body = GetBodyPane(i);
+    if(s.factory && !s.bodyBuilt) {
+        TraceScope tr(*this, "BuildBody", i);
+        s.bodyBuilt = true;
+        s.factory(body);
+        if(!s.async && !s.saved.IsVoid())
+            RestoreBody(s);
+    }
+}
+
+bool AccordionCtrl::RealizeDeferred(int first, int last) {
+    bool changed = false;
+    for(int i = first; i <= last; i++) {
+        Section& s = sections[i];
+        if(!openBits[i] || !s.factory || s.bodyBuilt || s.animating) continue;
+        RealizeBody(i);
+        int cy = s.lastBodyCy = BodyContentCy(i);
+        if(cy != s.currentBodyCy) {
+            SetBodyCy(i, cy);
+            SetTargetCy(s, cy);
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+AccordionCtrl& AccordionCtrl::SetBodyFactory(int i, Event<ParentCtrl&> factory) {
+    ASSERT(!model && i >= 0 && i < sections.GetCount());
+    Section& s = sections[i];
+    CancelAsync(s);
+    s.async.Clear();
+    s.factory = pick(factory);
+    ResetBody(i);
+    return *this;
+}
+
+void AccordionCtrl::ResetBody(int i) {
+    Section& s = sections[i];
+    s.bodyBuilt = false;
+    if(openBits[i]) {
+        RealizeBody(i);
+        StopAnimation(i);
+        SetBodyCy(i, BodyContentCy(i));
+        SetTargetCy(s, s.currentBodyCy);
+        Relayout();
+    }
+}
+
+bool AccordionCtrl::IsBodyRealized(int i) const {
+    ASSERT(!model && i >= 0 && i < sections.GetCount());
+    const Section& s = sections[i];
+    return s.body && (!s.factory || s.bodyBuilt) && !(s.async && s.async->job);
+}
+
+void AccordionCtrl::OnScroll() {
+    int dy = viewTop - sb.Get();
+    if(dy == 0) return;
+    // Blit what is already on screen; Layout moves the shown ctrls along with it
+    ScrollView(0, dy);
+    Layout();
+}
+
 
 
 }
\ No newline at end of file
@@ -29,33 +29,144 @@ public:
         int    sectionVGap         = 2;
         int    borderWidth         = 0;
         int    animMs              = 120;
+        int    bodyBottomPad       = 8;     // added below the lowest body child
+        int    indentCx            = 16;    // per nesting level
         bool   focusHeaderOnToggle = true;
     };
 
     static const Style& StyleDefault();
 
+    // Data source for virtual mode: sections are rows of the model, only the rows inside
+    // the viewport get a (pooled) header/body pane. Open/close is applied without animation.
+    struct Model {
+        virtual int    GetCount() const = 0;
+        virtual String GetTitle(int i) const = 0;
+        virtual bool   IsOpen(int i) const = 0;
+        virtual void   SetOpen(int i, bool open) = 0;
+        virtual bool   IsLocked(int i) const               { return false; } // locked in current state
+        virtual int    GetBodyHeight(int i) const = 0;     // height of the open body
+        virtual Ctrl*  CreateBody(int i)                   { return nullptr; } // ownership passes to AccordionCtrl
+        virtual void   ReleaseBody(int i, Ctrl& body)      {} // called before a realized body is destroyed;
+                                                           // i is the row it was created for as of the last
+                                                           // ModelChanged, -1 if that row no longer exists
+        virtual ~Model() {}
+    };
+
     AccordionCtrl();
+    ~AccordionCtrl();
 
     // Style
     AccordionCtrl&     SetStyle(const Style& st);
     const Style&       GetStyle() const;
 
+    // Virtual mode (model-backed sections; section management/formatting calls are not available)
+    AccordionCtrl&     SetModel(Model& m);
+    AccordionCtrl&     ClearModel();
+    bool               IsVirtual() const                            { return model; }
+    void               ModelChanged();            // row count or many rows changed
+    void               ModelChanged(int i);       // title/open/height of row i changed
+
     // Section management
     int                GetCount() const;
     int                AddSection(const String& title);
-    int                InsertSection(int at, const String& title);
-    void               RemoveSection(int i);
+    int                AddSection(const String& title, Event<ParentCtrl&> factory);
+    int                InsertSection(int at, const String& title); // sibling placed before section 'at'
+    void               RemoveSection(int i);                       // with its child sections
+
+    // Nested sections: children follow their parent (pre-order), are indented by
+    // Style::indentCx per level and are shown while every ancestor is open.
+    // SingleExpand applies among siblings.
+    int                AddSection(int parent, const String& title);
+    int                GetParent(int i) const;      // -1 for top level sections
+    int                GetDepth(int i) const;
+    int                GetChildCount(int i) const;  // direct children
+
+    // Reordering keeps the sections (and their header/body Ctrls) and relayouts once;
+    // sections move with their children and must be siblings. 'animate' slides the
+    // moved rows from their old to their new place.
+    void               MoveSection(int from, int to, bool animate = false); // 'from' ends up where 'to' is
+    void               SwapSections(int i, int j, bool animate = false);
+    void               SortSections(Function<bool (int, int)> less, bool animate = false); // siblings, stable
+    AccordionCtrl&     DragReorder(bool on = true);  // drag headers to reorder siblings
     void               Clear();
 
+    // Stable key used to match saved state to sections (the title when not set);
+    // keys set by SetKey should be unique and are found by hash
+    AccordionCtrl&     SetKey(int i, const String& key);
+    String             GetKey(int i) const;
+    int                FindSection(const String& key) const; // -1 if not found
+
+    // Filtering hides the sections that do not match as zero-height rows (nothing is destroyed)
+    // and relayouts once; ancestors of a match stay visible. Text matches case-insensitively
+    // anywhere in the title, and text that extends the previous one only re-checks its matches.
+    AccordionCtrl&     SetFilter(const String& text);                  // empty text clears the filter
+    AccordionCtrl&     SetFilterPredicate(Function<bool (int)> match); // on the section index
+    AccordionCtrl&     ClearFilter();
+    bool               IsFilterActive() const                       { return filtering; }
+    bool               IsFiltered(int i) const;                     // hidden by the filter
+    int                GetMatchCount() const                        { return filterHits.GetCount(); }
+    AccordionCtrl&     SetKeywords(int i, const String& keywords);  // extra text matched with FilterKeywords
+    AccordionCtrl&     FilterKeywords(bool on = true);
+    AccordionCtrl&     FilterAutoOpen(bool on = true);  // open matches and their ancestors, close them again when they stop matching
+
     // Access to section containers
     Ctrl&              HeaderCtrl(int i);
     ParentCtrl&        BodyCtrl(int i);
 
+    // Lazy bodies: factory fills the body the first time the section opens
+    AccordionCtrl&     SetBodyFactory(int i, Event<ParentCtrl&> factory);
+    bool               IsBodyRealized(int i) const;
+
+    // Asynchronous bodies: the first open runs 'worker' on the CoWork thread pool while the
+    // body shows a placeholder of placeholder_cy; 'builder' then fills the body with the result
+    // on the GUI thread. Closing or removing the section first cancels the worker's token.
+    class AsyncToken {
+        std::atomic<bool> canceled;
+        Value             result;
+        friend class AccordionCtrl;
+    public:
+        AsyncToken() : canceled(false) {}
+        bool IsCanceled() const                                     { return canceled; }
+    };
+
+    AccordionCtrl&     SetAsyncBody(int i, Function<Value (const AsyncToken&)> worker,
+                                    Event<ParentCtrl&, const Value&> builder, int placeholder_cy = 60);
+    bool               IsBodyPending(int i) const;  // worker still running
+
+    // Prewarming builds a closed section's lazy or async body before its first open: when the
+    // pointer rests on its header for dwell_ms or keyboard focus moves to it. Factories run
+    // from a timer once the GUI is idle, async workers start on the pool (at most max_jobs
+    // for closed sections); nothing is prewarmed while bodies built ahead exceed max_bytes.
+    AccordionCtrl&     Prewarm(bool on = true, int dwell_ms = 300, int max_jobs = 2, int64 max_bytes = 4 << 20);
+
+    // Body budget: built bodies of closed sections that their factory (or async body) can build
+    // again are kept in least-recently-closed order; past max_bodies or max_bytes (0 = no limit)
+    // the oldest are released and rebuilt on the next open. WhenBodySave runs before a release,
+    // WhenBodyRestore after the rebuild. Ctrls a factory creates with AddBodyCtrl are owned by
+    // the body and freed with it; others are only removed from it.
+    AccordionCtrl&     SetBodyBudget(int max_bodies, int64 max_bytes = 0);
+    Function<int64 (int, const ParentCtrl&)> WhenBodyBytes;  // size estimate, default counts the Ctrls
+    Event<int, ParentCtrl&, Value&>       WhenBodySave;
+    Event<int, ParentCtrl&, const Value&> WhenBodyRestore;
+
+    template <class T>
+    static T&          AddBodyCtrl(ParentCtrl& body)          { T& c = static_cast<BodyPane&>(body).owned.Create<T>(); body.Add(c); return c; }
+
+    // Body heights are measured once and cached; adding, removing or moving body children
+    // marks the section for re-measuring on the next layout. Content that changes size in
+    // other ways (e.g. grandchildren) calls InvalidateBodyHeight.
+    void               InvalidateBodyHeight(int i);
+    AccordionCtrl&     MeasureMinSize(bool on = true); // children's GetMinSize().cy instead of their current height
+
     // State
     bool               IsOpen(int i) const;
     void               Open(int i, bool animate = true);
     void               Close(int i, bool animate = true);
     void               Toggle(int i, bool animate = true);
+    Bits               GetOpenStates() const;   // bit i = section i open
+    void               SetOpenStates(const Bits& open, bool animate = false); // applies only the changes, as one batch
+
+    int                HitTestHeader(Point p) const; // section whose header contains p (view coordinates), -1 if none
 
     // Modes
     AccordionCtrl&     SingleExpand(bool b = true);
@@ -69,10 +180,22 @@ public:
     // Icons
     AccordionCtrl&     SetIcons(Image collapsed, Image expanded);
 
+    // Header render cache: headers of visible sections are kept as images per width/state,
+    // so repainting an unchanged header is a single DrawImage (not used in virtual mode)
+    AccordionCtrl&     CacheHeaders(bool on = true);
+
     // Animation
     AccordionCtrl&     SetAnimationMs(int ms);
 	AccordionCtrl&     SetAnimationEnabled(bool on = true);  
 	AccordionCtrl&     SetAnimationDurations(int open_ms, int close_ms); // close is typically faster
+	AccordionCtrl&     SetAnimationSnapshot(bool on = true); // animate a cached image of the body, lay out children once at the end
+
+	// Animations interpolate over time and end exactly at their duration. A frame whose
+	// Layout+Paint cost exceeds the budget makes the clock drop the following frames;
+	// after three such frames in a row running animations snap to their end.
+	enum { EASE_LINEAR, EASE_OUT, EASE_IN_OUT };  // EASE_OUT (cubic) is the default
+	AccordionCtrl&     SetAnimationEasing(int easing);
+	AccordionCtrl&     SetAnimationBudget(int ms);  // 0 = no limit; default is the frame interval
 
 	// Locking API  
 	AccordionCtrl&     SetLocked(int i, bool lock);   // lock in current state (open -> locked-open; closed -> locked-closed)  
@@ -80,15 +203,76 @@ public:
 	AccordionCtrl&     LockClosed(int i, bool lock = true);  
 	bool               IsLocked(int i) const;         // any section locked?  
 	  
-	// Bulk ops  
+	// Bulk ops (run as one batch update, see BeginUpdate)
 	AccordionCtrl& OpenAll(bool animate = true);  
 	AccordionCtrl& CloseAll(bool animate = true);
+
+    // Batch updates: between BeginUpdate and EndUpdate layout, refresh and SingleExpand
+    // reconciliation are deferred (each sibling group keeps the section opened in it last);
+    // EndUpdate fires WhenOpen/WhenClose once per touched section
+    // (for its final state), then reports them all in one WhenStateChanged call. Calls may nest.
+    void               BeginUpdate()                                { updateDepth++; }
+    void               EndUpdate();
+    bool               IsUpdating() const                           { return updateDepth > 0; }
+
+    struct Batch {
+        AccordionCtrl& ctrl;
+        Batch(AccordionCtrl& ctrl) : ctrl(ctrl) { ctrl.BeginUpdate(); }
+        ~Batch()                                { ctrl.EndUpdate(); }
+    };
+
+    // Size reported to parents: natural height (every section at its final open/closed height,
+    // kept as a running total) or, with ReportAnimatedSize, the height of the current frame
+    AccordionCtrl&     ReportAnimatedSize(bool on = true);
+    virtual Size       GetMinSize() const override;
+    virtual Size       GetStdSize() const override;
+
+    // Scrolling
+    AccordionCtrl&     ScrollToSection(int i, bool smooth = false); // section header to top of view
+    AccordionCtrl&     EnsureVisible(int i, bool smooth = false);   // minimal scroll to show section
+    AccordionCtrl&     SetSmoothScroll(bool on = true);             // default for wheel/keyboard scrolling
+    int                GetScroll() const                            { return viewTop; }
+
+    // Runtime counters (opt-in). Times are in microseconds; the Ctrl counts and the memory
+    // figure are sampled by GetStats.
+    struct Stats {
+        int    layoutCount   = 0;
+        int64  layoutUs      = 0;
+        int    paintCount    = 0;
+        int64  paintUs       = 0;
+        int    animFrames    = 0;   // frames delivered by the animation clock
+        int    animExpected  = 0;   // frames the clock should have delivered in the same time
+        int    animOverBudget = 0;  // frames whose Layout+Paint took longer than the budget
+        int    animDropped   = 0;   // clock ticks skipped after over-budget frames
+        int    animSnapped   = 0;   // times running animations were cut short
+        int    liveTimers    = 0;   // pending time callbacks of this control
+        int    headers       = 0;   // realized header panes
+        int    bodies        = 0;   // realized body panes
+        int64  memory        = 0;   // estimated bytes held by sections, panes and cached images
+    };
+
+    AccordionCtrl&     EnableStats(bool on = true, int period_ms = 1000); // period_ms > 0 fires WhenStats
+    bool               IsStatsEnabled() const                       { return statsOn; }
+    Stats              GetStats() const;
+    void               ResetStats();
+    Event<const Stats&> WhenStats;
+
+    // Trace recorder (opt-in): begin/end events of Open/Close, animation, Layout, Paint and
+    // body building/measuring are kept in a ring buffer of 'capacity' events
+    AccordionCtrl&     EnableTrace(bool on = true, int capacity = 8192);
+    bool               IsTracing() const                            { return tracing; }
+    void               ClearTrace();
+    String             GetTraceJson() const;  // Chrome trace event format (chrome://tracing, Perfetto)
+
     // Callbacks
     Event<int>         WhenOpen;
     Event<int>         WhenClose;
     Gate<int>          WhenBeforeToggle;
+    Event<>            WhenReorder;                 // user reordered sections by dragging
+    Event<const Vector<int>&> WhenStateChanged;   // sections whose open state changed (one call per batch)
 
-    // Persistence
+    // Persistence (v3: keys, nesting, open/lock state and body heights; loading maps the state onto
+    // existing sections by key in place and only creates sections when the control is empty)
     virtual void       Serialize(Stream& s) override;
 
     // Ctrl overrides
@@ -97,6 +281,7 @@ public:
 
 protected:
     virtual bool       Key(dword key, int count) override;
+    virtual void       MouseWheel(Point p, int zdelta, dword keyflags) override;
     virtual void       MouseMove(Point p, dword keyflags) override;
     virtual void       MouseLeave() override;
     virtual void       LeftUp(Point p, dword keyflags) override; // NEW: finalize clicks even without mouse move
@@ -123,33 +308,179 @@ private:
 	    virtual void MouseLeave() override {
 	        if(owner) owner->OnHeaderMouseLeave(index);
 	    }
+	    virtual void MouseWheel(Point p, int zdelta, dword keyflags) override {
+	        if(owner) owner->MouseWheel(p, zdelta, keyflags);
+	    }
+	    virtual void GotFocus() override      { if(owner) owner->focusSection = index; }
+	    virtual void ChildGotFocus() override { if(owner) owner->focusSection = index; }
+	    virtual void LostFocus() override     { if(owner && owner->focusSection == index) owner->focusSection = -1; }
+	    virtual void ChildLostFocus() override { if(owner && owner->focusSection == index) owner->focusSection = -1; }
+	};
+
+	struct Section;
+
+	// Body pane forwards wheel to owner so scrolling works over body content and reports
+	// content changes for re-measuring (child moves arrive through StateHook)
+	struct BodyPane : ParentCtrl {
+	    AccordionCtrl* owner = nullptr;
+	    Section*       section = nullptr; // null for virtual mode slots
+	    Array<Ctrl>    owned;             // AddBodyCtrl
+
+	    virtual void MouseWheel(Point p, int zdelta, dword keyflags) override {
+	        if(owner) owner->MouseWheel(p, zdelta, keyflags);
+	    }
+	    virtual void ChildAdded(Ctrl *) override   { if(owner) owner->BodyChanged(section); }
+	    virtual void ChildRemoved(Ctrl *) override { if(owner) owner->BodyChanged(section); }
+	};
+
+	struct AsyncBody {
+	    Function<Value (const AsyncToken&)> worker;
+	    Event<ParentCtrl&, const Value&>    builder;
+	    int                                 placeholderCy = 0;
+	    std::shared_ptr<AsyncToken>         job;   // running worker, empty when idle
+	};
+
+	// CacheHeaders: one rendering per visual state (hot | open << 1 | locked << 2), so hover
+	// and press switch between images instead of re-rendering
+	struct HeaderImages {
+	    Image   img[8];
+	    int64   key[8] = {};    // serial/width each image was rendered for
 	};
-        
-    enum LockMode { UNLOCKED, LOCKED_OPEN, LOCKED_CLOSED };
-   
+
 	struct Section {  
 	    One<HeaderPane> header;  
-	    One<ParentCtrl> body;  
+	    One<BodyPane>   body;   // created on demand (BodyCtrl or first open)
+	    Event<ParentCtrl&> factory;
+	    One<AsyncBody>  async;  // SetAsyncBody; 'factory' starts the worker
+	    bool    bodyBuilt     = false;  // factory has run
 	    String  title;  
+	    String  key;
+	    int     keyPos        = -1; // entry in 'keys'
+	    int     index         = 0;  // position, valid below indexFrom
 	    int     align         = ALIGN_LEFT;  
 	    bool    useDivider    = false;  
-	    bool    open          = false;  
 	    bool    animating     = false;  
 	    int     currentBodyCy = 0;  
 	    int     targetBodyCy  = 0;  
-	    int     animTicket    = 0;  
-	    bool    hot           = false;  
-	    bool    pressed       = false;  
-	    Rect    headerRect;  
-	    Rect    bodyRect;  
-	    Rect    iconRect;  
-	    LockMode lock         = UNLOCKED;  // NEW  
+	    int     animDuration  = 0;  // ms, set by StartAnimation
+	    int     animStart     = 0;  // msecs() when the animation (re)started
+	    int     animFrom      = 0;  // body height at animStart
+	    bool    animFresh     = false; // no frame yet: rows below may have moved for other reasons
+	    int     lastBodyCy    = 0;  // last measured open height (persisted)
+	    int     contentCy     = 0;  // cached measurement, valid unless heightDirty
+	    bool    heightDirty   = true;
+	    Section *parent       = nullptr;
+	    int     depth         = 0;
+	    int     childCount    = 0;
+	    bool    hidden        = false; // zero-height row: collapsed or filtered
+	    bool    collapsed     = false; // inside a closed parent
+	    bool    filtered      = false; // does not match the filter, nor does any descendant
+	    int     filterMark    = 0;     // filterSerial of the last pass that kept it
+	    String  lower;              // lowercase title, built by the first filter that needs it
+	    String  keywords;           // lowercase
+	    int     shiftFrom     = 0;     // reflow animation: offset from the old position...
+	    int     shift         = 0;     // ...and what is left of it
+	    Image   snapshot;           // body rendered at full size while a snapshot animation runs
+	    One<HeaderImages> headerImg; // CacheHeaders: created once the section is painted
+	    int     shownSerial   = 0;  // Layout pass that last showed this section's ctrls
+	    int     lruStamp      = 0;  // body budget: closing order, 0 = not tracked
+	    int64   bodyBytes     = 0;  // estimate taken when it was closed
+	    bool    notifyPending = false; // in updateNotify
+	    Value   saved;              // WhenBodySave result, handed to WhenBodyRestore
+	};
+
+	// Pooled header/body panes realized for visible rows in virtual mode
+	struct Slot {
+	    HeaderPane header;
+	    BodyPane   body;
+	    One<Ctrl>  content;   // body created by Model::CreateBody for 'row'
+	    int        row = -1;  // -1 = free
+	};
+
+	// Fenwick tree over row heights: O(log N) height update, row offset and offset -> row lookup
+	struct RowIndex {
+	    Vector<int> tree;   // 1-based
+	    int         total = 0;
+
+	    int  GetCount() const          { return max(tree.GetCount() - 1, 0); }
+	    template <class F>
+	    void Build(int n, F rowcy) {
+	        tree.SetCount(n + 1);
+	        tree[0] = total = 0;
+	        for(int k = 1; k <= n; k++) {
+	            tree[k] = rowcy(k - 1);
+	            total += tree[k];
+	        }
+	        for(int k = 1; k <= n; k++) {
+	            int up = k + (k & -k);
+	            if(up <= n) tree[up] += tree[k];
+	        }
+	    }
+	    void Add(int i, int delta) {
+	        total += delta;
+	        for(int k = i + 1; k < tree.GetCount(); k += k & -k) tree[k] += delta;
+	    }
+	    int  Offset(int i) const {     // sum of rows [0, i)
+	        int sum = 0;
+	        for(int k = i; k > 0; k -= k & -k) sum += tree[k];
+	        return sum;
+	    }
+	    int  Find(int y) const {       // largest i with Offset(i) <= y, i.e. the row containing y
+	        int n = GetCount(), pos = 0;
+	        int step = 1;
+	        while(step * 2 <= n) step *= 2;
+	        for(; step; step /= 2)
+	            if(pos + step <= n && tree[pos + step] <= y) {
+	                pos += step;
+	                y -= tree[pos];
+	            }
+	        return pos;
+	    }
+	};
+
+	enum { ANIM_FRAME_MS = 16 }; // animation clock interval
+
+	// Adds the time spent in its scope to a Stats counter pair when stats are on
+	struct StatScope {
+	    int&   count;
+	    int64& us;
+	    int64  t0;
+	    bool   on;
+	    StatScope(bool on, int& count, int64& us) : count(count), us(us), t0(on ? usecs() : 0), on(on) {}
+	    ~StatScope() { if(on) { count++; us += usecs(t0); } }
+	};
+
+	struct TraceRec : Moveable<TraceRec> {
+	    int64       ts;
+	    const char *name;
+	    int         section;
+	    char        phase;   // 'B' or 'E'
+	};
+
+	// Records a begin/end event pair around its scope when tracing is on
+	struct TraceScope {
+	    const AccordionCtrl *ctrl;
+	    const char          *name;
+	    int                  section;
+	    TraceScope(const AccordionCtrl& c, const char *name, int section = -1)
+	    :   ctrl(c.tracing ? &c : nullptr), name(name), section(section) { if(ctrl) ctrl->Trace('B', name, section); }
+	    ~TraceScope() { if(ctrl) ctrl->Trace('E', name, section); }
+	};
+
+	enum {
+	    TIMEID_SCROLL = Ctrl::TIMEID_COUNT,
+	    TIMEID_ANIM,
+	    TIMEID_STATS,
+	    TIMEID_MEASURE,
+	    TIMEID_PREWARM,
+	    TIMEID_COUNT
 	};
 
 	// Animation knobs  
 	bool animEnabled = true;   // on/off at runtime  
 	int  animOpenMs  = 160;    // opening duration  
 	int  animCloseMs = 80;     // closing duration (2× faster)
+	bool animSnapshot = false; // reveal a body snapshot instead of relayouting children every frame
 
     // HeaderPane -> owner handlers
     void              OnHeaderLeftDown(int i);
@@ -157,26 +488,221 @@ private:
     void              OnHeaderMouseLeave(int i);
 
     // Utilities
-    int               HitTestHeader(Point p) const;
-    int               GetBodyMinHeight(int i) const;
+    void              Trace(char phase, const char *name, int section) const;
+    int               GetBodyMinHeight(int i) const;   // measures
+    int               BodyContentCy(int i);              // cached GetBodyMinHeight
+    void              BodyChanged(Section *s);
+    bool              RemeasureBodies();
+    static bool       StateHook(Ctrl *ctrl, int reason);
     void              StopAnimation(int i);
     void              StartAnimation(int i, int targetHeight, int duration_ms);
-    void              AnimTick(int i, int ticket);
+    void              StartClock();
+    void              AnimFrame();
+    double            Ease(double t) const;
+    void              SnapAnimations();
+    void              TakeSnapshot(int i, int cy);
+    bool              ScrollBelow(int i, int bottom, int oldTotal); // false if the frame needs a full repaint
+    int               IndexOf(const Section& s) const;
     void              EnsureAtLeastOneOpen(int skip);
     void              CloseOthers(int keep);
+    bool              HasOpenSibling(int i) const;
+    void              ApplySingleExpand();
     void              RefreshSection(int i);
-    void              UpdateHeaderIndices();
+    void              SectionsMoved(int from)       { indexFrom = min(indexFrom, from); }
+    void              UnlinkKey(Section& s);
+    void              Relayout();                      // Layout + Refresh, deferred while updating
+    void              NotifyState(int i, bool open);   // WhenOpen/WhenClose/WhenStateChanged, batched while updating
+    void              SetOpenFlag(int i, bool open);
+    void              SetLockFlag(int i, bool lock);
+    void              InsertStateBits(int at);       // after sections.Insert(at)
+    void              RemoveStateBits(int i);        // before sections.Remove(i)
+
+    // Geometry / viewport (content coordinates are view + viewTop)
+    int               RowTop(int i) const           { UpdateGeometry(); return style->borderWidth + rows.Offset(i); }
+    int               RowBodyCy(int i) const        { return model ? vbody[i] : sections[i].currentBodyCy; }
+    int               FullRowCy(int i) const        { return style->headerCy + RowBodyCy(i) + style->sectionVGap; }
+    int               RowCy(int i) const            { return !model && sections[i].hidden ? 0 : FullRowCy(i); }
+    void              SetBodyCy(int i, int cy);
+    void              SetTargetCy(Section& s, int cy) { if(!s.hidden) targetTotal += cy - s.targetBodyCy; s.targetBodyCy = cy; }
+    int               GetReportedCy() const;
+    void              SizeChanged();                // RefreshParentLayout when the reported height moved
+    void              GeometryChanged()             { geomDirty = true; } // row count or style changed
+    void              UpdateGeometry() const;
+    int               SectionAt(int y) const;       // section containing content y (clamped), -1 if none
+    Rect              GetHeaderRect(int i) const;   // view coordinates
+    Rect              GetBodyRect(int i) const;
+    Rect              GetIconRect(const Rect& header) const;
+    void              ScrollTo(int pos, bool smooth);
+    void              ScrollTick();
+    void              OnScroll();
+    enum { ICON_CLOSED, ICON_OPENED, ICON_LOCK };
+    static Image      CachedIcon(int kind, int px, Color ink);
+    Image             GetIcon(int kind) const;
+    void              PaintHeader(Draw& w, const Rect& r, const String& title, bool open, bool locked,
+                                  bool useDivider, bool hot) const;
+    void              PaintCachedHeader(Draw& w, int i, const Rect& r, bool hot);
+    void              InvalidateHeaders()           { headerSerial++; }
+    Ctrl*             GetHeaderPane(int i);
+    BodyPane&         GetBodyPane(int i);
+    void              RealizeBody(int i);
+    void              ResetBody(int i);             // after the factory changed
+    void              StartAsync(Section& s);
+    void              AsyncDone(const std::shared_ptr<AsyncToken>& job);
+    void              CancelAsync(Section& s);
+    void              PaintPlaceholder(Draw& w, const Rect& r) const;
+    void              SchedulePrewarm(int i, int delay);
+    void              PrewarmTarget();
+    void              ForgetPrewarm(Section& s);  // opened or removed
+    int64             PrewarmBytes() const;
+    static int64      CtrlBytes(const Ctrl& c);
+
+    // Body budget
+    void              BodyClosed(Section& s);
+    void              BodyOpened(Section& s);
+    void              EnforceBodyBudget();
+    void              ReleaseBody(Section& s);
+    void              RestoreBody(Section& s);      // after the factory/builder rebuilt a released body
+    bool              RealizeDeferred(int first, int last);
+    void              RestoreState(int i, bool open, bool locked, int cy);
+
+    // Tree
+    int               InsertChild(int at, Section *parent, const String& title);
+    void              RemoveOne(int i);
+    int               SubtreeEnd(int i) const;      // one past the last descendant
+    void              SetHidden(int i, bool hide);
+    void              SetCollapsed(int i, bool c);
+    void              UpdateSubtree(int i);         // descendants follow i's open/hidden state
+    int               NextShown(int i, int dir) const; // first non-hidden section from i on, -1 if none
+
+    // Filter
+    bool              FilterMatch(Section& s);
+    void              RunFilter(bool narrow);
+    void              UpdateFiltered();             // filtered flags from filterHits
+    void              AutoOpen();
+    void              SetFiltered(int i, bool f);
+    void              FilterInserted(int i);
+    void              FilterChanged(int i);         // title/keywords of i changed
+    bool              FilterRemoved(Section& s);    // before s leaves 'sections', true if ancestors may have lost their match
+
+    // Reordering
+    void              ApplyOrder(const Vector<Section*>& order, bool animate);
+    void              AddSubtree(Vector<Section*>& order, int i) const;
+    int               DragTarget(Point p) const;
+
+    // Virtual mode
+    void              SyncModelRows();
+    void              SetModelOpen(int i, bool open);
+    void              LayoutVirtual(int first, int last);
+    void              ReleaseSlot(Slot& q);
+    void              ReleaseSlots();
 
     Array<Section>    sections;
+    mutable int       indexFrom     = 0;     // Section::index is renumbered lazily from here on
+    Index<String>     keys;                  // SetKey keys, unlinked on change/remove
+    Vector<Section*>  keyOwner;              // section of each 'keys' entry
     const Style*      style;
-    Image             iconClosed;
+    Image             iconClosed;            // custom icons from SetIcons, empty = shared cache
     Image             iconOpened;
-    Image             iconLock;
     bool              singleExpand;
     bool              enforceOne;
     int               hotSection;
     int               pressedSection;
-    
+    bool              pressedInside = false;  // pointer still over the pressed header
+
+    Model*            model = nullptr;
+    Array<Slot>       slots;
+    Vector<int>       vbody;                 // virtual mode: current body heights
+
+    Vector<Section*>  anims;                 // sections advanced by the shared frame clock
+    int               animLastMs    = 0;
+    int               animEasing    = EASE_OUT;
+    int               animBudgetMs  = ANIM_FRAME_MS;
+    int64             animPaintUs   = 0;     // Paint time since the last frame
+    int               animSkip      = 0;     // ticks still to drop
+    int               animOverRun   = 0;     // consecutive over-budget frames
+    Vector<Section*>  reflow;                // sections sliding to a new place after a reorder
+    int               reflowStart   = 0;
+    int               reflowMax     = 0;     // largest |shift|, widens culling while sliding
+
+    bool              filtering     = false;
+    String            filterText;            // lowercase
+    Function<bool (int)> filterPred;
+    Vector<Section*>  filterHits;            // sections that match by themselves
+    Vector<Section*>  autoOpened;            // sections opened by FilterAutoOpen
+    int               filterSerial  = 0;
+    bool              filterKeywords = false;
+    bool              filterAutoOpen = false;
+
+    Vector<Section*>  asyncPending;          // sections whose worker is running
+
+    bool              prewarm       = false;
+    int               prewarmDwellMs = 300;
+    int               prewarmJobs   = 2;
+    int64             prewarmMaxBytes = 4 << 20;
+    Section*          prewarmTarget = nullptr; // waiting for TIMEID_PREWARM
+    Vector<Section*>  prewarmed;             // closed sections built ahead
+
+    struct LruEntry : Moveable<LruEntry> {
+        Section *section;  // null once removed
+        int      stamp;    // stale unless it equals section->lruStamp
+    };
+    int               maxBodies     = 0;
+    int64             maxBodyBytes  = 0;
+    Vector<LruEntry>  lru;                   // closed bodies, oldest first from lruHead
+    int               lruHead       = 0;
+    int               lruCount      = 0;     // live entries
+    int64             lruBytes      = 0;
+    int               lruSerial     = 0;
+
+    bool              dragReorder   = false;
+    bool              dragging      = false;
+    Point             dragStart;
+    int               dropTarget    = -1;
+
+    bool              headerCache   = false;
+    int               headerSerial  = 0;     // bumped to drop all cached headers
+    Color             headerCacheInk;        // SColorText() the cache was rendered with
+
+    ScrollBar         sb;
+    Vector<Section*>  shown;                 // sections whose ctrls are currently visible
+    int               layoutSerial  = 0;
+    mutable RowIndex  rows;                  // row offsets, rebuilt lazily after structural changes
+    mutable bool      geomDirty     = true;
+    mutable int       totalCy       = 0;     // content height
+    int               targetTotal   = 0;     // sum of targetBodyCy of non-hidden sections
+    int               hiddenCount   = 0;
+    int               nestedCount   = 0;     // sections with a parent
+    bool              reportAnimated = false;
+    int               reportedCy    = Null;  // height parents last saw
+    Vector<Section*>  remeasure;             // open sections whose heightDirty was set by BodyChanged
+    bool              measureMinSize = false;
+    bool              placingBodies = false; // own SetRect calls, ignored by StateHook
+    int               focusSection  = -1;    // header holding (deep) focus, tracked by HeaderPane
+
+    // Non-virtual open/lock state by section index. A locked section is pinned in the state
+    // openBits holds (locked-open or locked-closed); the counts keep mode checks O(1).
+    Bits              openBits;
+    Bits              lockBits;
+    int               openCount     = 0;
+    int               lockOpenCount = 0;     // open and locked
+
+    int               updateDepth   = 0;
+    bool              updatePending = false; // Relayout requested while updating
+    int               updateKeep    = -1;    // last model row opened while updating (SingleExpand winner)
+    VectorMap<Section*, Section*> updateKeeps; // parent -> last child opened while updating
+    Index<int>        updateChanged;         // model rows opened/closed while updating
+    Vector<Section*>  updateNotify;          // sections opened/closed while updating
+    int               viewTop       = 0;     // scroll position applied by the last Layout
+    int               scrollTarget  = Null;  // smooth scroll destination
+    bool              smoothScroll  = false;
+
+    bool              statsOn       = false;
+    Stats             stats;                 // accumulated counters, sampled fields filled by GetStats
+
+    bool              tracing       = false;
+    mutable Vector<TraceRec> trace;          // ring buffer
+    mutable int       traceHead     = 0;     // next slot to write
+    mutable bool      traceWrapped  = false;
 };
 
 }
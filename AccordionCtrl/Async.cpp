@@ -0,0 +1,103 @@
+#include "AccordionCtrl.h"
+
+namespace Upp {
+
+// Asynchronous bodies: the section's factory starts the worker instead of filling the body,
+// so opening, deferred realization and restored state all go through the usual lazy path.
+// Until the worker reports back, BodyContentCy is the placeholder height and Paint draws a
+// skeleton there.
+
+AccordionCtrl& AccordionCtrl::SetAsyncBody(int i, Function<Value (const AsyncToken&)> worker,
+                                           Event<ParentCtrl&, const Value&> builder, int placeholder_cy)
+{
+    ASSERT(!model && i >= 0 && i < sections.GetCount());
+    Section& s = sections[i];
+    CancelAsync(s);
+    AsyncBody& a = s.async.Create();
+    a.worker = pick(worker);
+    a.builder = pick(builder);
+    a.placeholderCy = max(0, placeholder_cy);
+    s.factory = [this, &s](ParentCtrl&) { StartAsync(s); };
+    ResetBody(i);
+    return *this;
+}
+
+bool AccordionCtrl::IsBodyPending(int i) const {
+    ASSERT(!model && i >= 0 && i < sections.GetCount());
+    const Section& s = sections[i];
+    return s.async && s.async->job;
+}
+
+void AccordionCtrl::StartAsync(Section& s) {
+    TraceScope tr(*this, "AsyncStart", IndexOf(s));
+    auto job = std::make_shared<AsyncToken>();
+    s.async->job = job;
+    asyncPending.Add(&s);
+
+    Ptr<AccordionCtrl> self = this;
+    Function<Value (const AsyncToken&)> worker = s.async->worker;
+    CoWork::Start([=] {
+        if(!job->IsCanceled())
+            job->result = worker(*job);
+        // The result is picked up on the GUI thread, unless the control is gone by then
+        Upp::PostCallback([=] { if(self) self->AsyncDone(job); }); // not Ctrl::PostCallback, this is a worker thread
+    });
+}
+
+void AccordionCtrl::AsyncDone(const std::shared_ptr<AsyncToken>& job) {
+    Section *s = nullptr;
+    for(int k = 0; k < asyncPending.GetCount(); k++)
+        if(asyncPending[k]->async->job == job) {
+            s = asyncPending[k];
+            asyncPending.Remove(k);
+            break;
+        }
+    if(!s) return; // canceled meanwhile
+
+    s->async->job.reset();
+    int i = IndexOf(*s);
+    {
+        TraceScope tr(*this, "BuildBody", i);
+        s->async->builder(GetBodyPane(i), job->result);
+        if(!s->saved.IsVoid())
+            RestoreBody(*s);
+    }
+    if(!openBits[i]) { // prewarmed: measured now, so the open finds the height cached
+        BodyContentCy(i);
+        BodyClosed(*s);
+        return;
+    }
+
+    // Grows (or shrinks) from the placeholder to the measured body
+    int cy = s->lastBodyCy = BodyContentCy(i);
+    if(animEnabled && animOpenMs > 0)
+        StartAnimation(i, cy, animOpenMs);
+    else {
+        StopAnimation(i);
+        SetBodyCy(i, cy);
+        SetTargetCy(*s, cy);
+        Relayout();
+    }
+}
+
+void AccordionCtrl::CancelAsync(Section& s) {
+    if(!s.async || !s.async->job) return;
+    s.async->job->canceled = true;
+    s.async->job.reset();
+    s.bodyBuilt = false; // the next open starts a new worker
+    for(int k = 0; k < asyncPending.GetCount(); k++)
+        if(asyncPending[k] == &s) { asyncPending.Remove(k); break; }
+}
+
+void AccordionCtrl::PaintPlaceholder(Draw& w, const Rect& r) const {
+    // Skeleton text lines, every third one shorter
+    Color c = Blend(SColorFace(), SColorPaper(), 128);
+    int h = max(style->headerCy / 4, 4);
+    int x = r.left + style->headerLPad;
+    int cx = r.GetWidth() - style->headerLPad - style->headerRPad;
+    int k = 0;
+    for(int y = r.top + style->headerLPad; y + h <= r.bottom - style->bodyBottomPad; y += 2 * h)
+        w.DrawRect(x, y, ++k % 3 ? cx : cx / 2, h, c);
+}
+
+}
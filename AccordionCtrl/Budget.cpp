@@ -0,0 +1,102 @@
+#include "AccordionCtrl.h"
+
+namespace Upp {
+
+// Body budget: closing a section with a rebuildable body appends it to 'lru'. Opening it
+// again only clears its lruStamp; the entry goes stale and is skipped, so both ends are O(1).
+// EnforceBodyBudget releases from the oldest end until the closed bodies fit.
+
+AccordionCtrl& AccordionCtrl::SetBodyBudget(int max_bodies, int64 max_bytes) {
+    ASSERT(!model);
+    maxBodies = max(0, max_bodies);
+    maxBodyBytes = max<int64>(0, max_bytes);
+    if(!maxBodies && !maxBodyBytes) {
+        for(Section& s : sections)
+            s.lruStamp = 0;
+        lru.Clear();
+        lruHead = lruCount = 0;
+        lruBytes = 0;
+        return *this;
+    }
+    for(int i = 0; i < sections.GetCount(); i++) // bodies closed before the budget was set
+        if(!openBits[i])
+            BodyClosed(sections[i]);
+    EnforceBodyBudget();
+    return *this;
+}
+
+void AccordionCtrl::BodyClosed(Section& s) {
+    if(!maxBodies && !maxBodyBytes) return;
+    if(s.lruStamp || !s.body || !s.factory || !s.bodyBuilt) return;
+    if(lru.GetCount() - lruHead > 2 * lruCount + 64) { // mostly stale: keep the live entries
+        Vector<LruEntry> live;
+        for(int k = lruHead; k < lru.GetCount(); k++)
+            if(lru[k].section && lru[k].section->lruStamp == lru[k].stamp)
+                live.Add(lru[k]);
+        lru = pick(live);
+        lruHead = 0;
+    }
+    s.lruStamp = ++lruSerial;
+    s.bodyBytes = 0;
+    if(maxBodyBytes)
+        s.bodyBytes = WhenBodyBytes ? WhenBodyBytes(IndexOf(s), *s.body) : CtrlBytes(*s.body);
+    LruEntry& e = lru.Add();
+    e.section = &s;
+    e.stamp = s.lruStamp;
+    lruCount++;
+    lruBytes += s.bodyBytes;
+    EnforceBodyBudget();
+}
+
+void AccordionCtrl::BodyOpened(Section& s) {
+    if(!s.lruStamp) return;
+    s.lruStamp = 0;
+    lruCount--;
+    lruBytes -= s.bodyBytes;
+}
+
+void AccordionCtrl::EnforceBodyBudget() {
+    auto over = [&] {
+        return (maxBodies && lruCount > maxBodies) || (maxBodyBytes && lruBytes > maxBodyBytes);
+    };
+    while(over() && lruHead < lru.GetCount()) {
+        Section *s = lru[lruHead].section;
+        if(s && s->lruStamp == lru[lruHead].stamp) {
+            if(s->animating)
+                break; // still closing, AnimFrame retries when it ends
+            BodyOpened(*s);
+            ReleaseBody(*s);
+        }
+        lruHead++;
+    }
+    if(lruHead > 64 && 2 * lruHead > lru.GetCount()) {
+        lru.Remove(0, lruHead);
+        lruHead = 0;
+    }
+}
+
+void AccordionCtrl::ReleaseBody(Section& s) {
+    int i = IndexOf(s);
+    TraceScope tr(*this, "ReleaseBody", i);
+    CancelAsync(s);
+    ForgetPrewarm(s);
+    if(!s.body) return;
+    if(WhenBodySave) {
+        Value v;
+        WhenBodySave(i, *s.body, v);
+        s.saved = v;
+    }
+    s.body->owner = nullptr; // its children leave without reporting back
+    s.body.Clear();          // frees the AddBodyCtrl Ctrls
+    s.bodyBuilt = false;
+    s.heightDirty = true;
+    s.snapshot = Image();
+}
+
+void AccordionCtrl::RestoreBody(Section& s) {
+    Value v = s.saved;
+    s.saved = Value();
+    WhenBodyRestore(IndexOf(s), *s.body, v);
+}
+
+}
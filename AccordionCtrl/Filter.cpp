@@ -0,0 +1,198 @@
+#include "AccordionCtrl.h"
+
+namespace Upp {
+
+// Filtering: a section that does not match is a zero-height row like the children of a
+// closed section (hidden = collapsed || filtered), so it keeps its Ctrls and state.
+// 'filterHits' holds the sections matching the current filter (sections inserted or edited
+// while filtering are appended, so not in position order); text that extends the previous
+// text can only match a subset of them, so only those are checked again.
+
+bool AccordionCtrl::FilterMatch(Section& s) {
+    if(filterPred)
+        return filterPred(IndexOf(s));
+    if(s.lower.IsEmpty() && s.title.GetCount())
+        s.lower = ToLower(s.title);
+    return s.lower.Find(filterText) >= 0 || (filterKeywords && s.keywords.Find(filterText) >= 0);
+}
+
+AccordionCtrl& AccordionCtrl::SetFilter(const String& text) {
+    ASSERT(!model);
+    String t = ToLower(TrimBoth(text));
+    if(t.IsEmpty())
+        return ClearFilter();
+    bool was = filtering && !filterPred;
+    if(was && t == filterText)
+        return *this;
+    bool narrow = was && t.Find(filterText) >= 0;
+    filterPred.Clear();
+    filterText = t;
+    filtering = true;
+    RunFilter(narrow);
+    return *this;
+}
+
+AccordionCtrl& AccordionCtrl::SetFilterPredicate(Function<bool (int)> match) {
+    ASSERT(!model);
+    if(!match)
+        return ClearFilter();
+    filterPred = pick(match);
+    filterText.Clear();
+    filtering = true;
+    RunFilter(false);
+    return *this;
+}
+
+AccordionCtrl& AccordionCtrl::ClearFilter() {
+    if(!filtering) return *this;
+    Batch batch(*this);
+    filtering = false;
+    filterText.Clear();
+    filterPred.Clear();
+    filterHits.Clear();
+    for(int i = 0; i < sections.GetCount(); i++)
+        SetFiltered(i, false);
+    Vector<Section*> opened = pick(autoOpened);
+    for(int k = opened.GetCount() - 1; k >= 0; k--) // children before their parents
+        Close(IndexOf(*opened[k]), false);
+    Relayout();
+    return *this;
+}
+
+bool AccordionCtrl::IsFiltered(int i) const {
+    ASSERT(!model && i >= 0 && i < sections.GetCount());
+    return sections[i].filtered;
+}
+
+AccordionCtrl& AccordionCtrl::SetKeywords(int i, const String& keywords) {
+    ASSERT(!model && i >= 0 && i < sections.GetCount());
+    sections[i].keywords = ToLower(keywords);
+    FilterChanged(i);
+    return *this;
+}
+
+AccordionCtrl& AccordionCtrl::FilterKeywords(bool on) {
+    if(filterKeywords != on) {
+        filterKeywords = on;
+        if(filtering) RunFilter(false);
+    }
+    return *this;
+}
+
+AccordionCtrl& AccordionCtrl::FilterAutoOpen(bool on) {
+    if(filterAutoOpen != on) {
+        filterAutoOpen = on;
+        if(filtering) RunFilter(false);
+    }
+    return *this;
+}
+
+void AccordionCtrl::RunFilter(bool narrow) {
+    TraceScope tr(*this, "Filter");
+    Batch batch(*this);
+    Vector<Section*> hits;
+    if(narrow) {
+        for(Section *s : filterHits)
+            if(FilterMatch(*s))
+                hits.Add(s);
+    }
+    else
+        for(Section& s : sections)
+            if(FilterMatch(s))
+                hits.Add(&s);
+    filterHits = pick(hits);
+    UpdateFiltered();
+    AutoOpen();
+}
+
+void AccordionCtrl::UpdateFiltered() {
+    // Marks the matches and their ancestors, everything else is filtered
+    filterSerial++;
+    for(Section *s : filterHits)
+        for(Section *p = s; p && p->filterMark != filterSerial; p = p->parent)
+            p->filterMark = filterSerial;
+    for(int i = 0; i < sections.GetCount(); i++)
+        SetFiltered(i, sections[i].filterMark != filterSerial);
+    Relayout();
+}
+
+void AccordionCtrl::AutoOpen() {
+    if(!filterAutoOpen) return;
+    // Sections opened for an earlier filter close once they are neither a match nor an ancestor of one
+    for(int k = autoOpened.GetCount() - 1; k >= 0; k--) {
+        Section *s = autoOpened[k];
+        if(s->filterMark != filterSerial) {
+            autoOpened.Remove(k);
+            Close(IndexOf(*s), false);
+        }
+    }
+    // Parents first, so the children are not opened while still collapsed. With SingleExpand
+    // only the topmost match is opened.
+    Vector<Section*> open;
+    if(singleExpand) {
+        Section *first = nullptr;
+        for(Section *s : filterHits)
+            if(!first || IndexOf(*s) < IndexOf(*first))
+                first = s;
+        for(Section *p = first; p; p = p->parent)
+            open.Add(p);
+    }
+    else
+        for(Section *s : filterHits)
+            for(Section *p = s; p; p = p->parent)
+                open.Add(p);
+    Sort(open, [&](Section *a, Section *b) { return IndexOf(*a) < IndexOf(*b); });
+    for(int k = 0; k < open.GetCount(); k++) {
+        if(k && open[k] == open[k - 1]) continue;
+        int i = IndexOf(*open[k]);
+        if(openBits[i]) continue;
+        Open(i, false);
+        if(openBits[i])
+            autoOpened.Add(open[k]);
+    }
+}
+
+void AccordionCtrl::SetFiltered(int i, bool f) {
+    Section& s = sections[i];
+    s.filtered = f;
+    SetHidden(i, s.collapsed || f);
+}
+
+void AccordionCtrl::FilterInserted(int i) {
+    // The new row is not counted in the geometry yet, the caller sets its 'hidden'
+    Section& s = sections[i];
+    if(!FilterMatch(s)) {
+        s.filtered = true;
+        return;
+    }
+    filterHits.Add(&s);
+    for(Section *p = s.parent; p && p->filtered; p = p->parent)
+        SetFiltered(IndexOf(*p), false);
+}
+
+void AccordionCtrl::FilterChanged(int i) {
+    Section& s = sections[i];
+    s.lower.Clear();
+    if(!filtering) return;
+    int q = -1;
+    for(int k = 0; k < filterHits.GetCount(); k++)
+        if(filterHits[k] == &s) { q = k; break; }
+    bool hit = FilterMatch(s);
+    if(hit == (q >= 0)) return;
+    if(hit) filterHits.Add(&s);
+    else    filterHits.Remove(q);
+    UpdateFiltered();
+}
+
+bool AccordionCtrl::FilterRemoved(Section& s) {
+    for(int k = 0; k < autoOpened.GetCount(); k++)
+        if(autoOpened[k] == &s) { autoOpened.Remove(k); break; }
+    for(int k = 0; k < filterHits.GetCount(); k++)
+        if(filterHits[k] == &s) {
+            filterHits.Remove(k);
+            return s.parent != nullptr;
+        }
+    return false;
+}
+
+}
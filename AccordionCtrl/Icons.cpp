@@ -0,0 +1,110 @@
+#include "AccordionCtrl.h"
+
+namespace Upp {
+
+static Image MakeChevronRight(int sz, Color ink) {
+    ImageBuffer ib(sz, sz);
+    Fill(~ib, RGBAZero(), ib.GetLength());
+    BufferPainter p(ib); // AA vector drawing
+
+    int cx = sz / 2, cy = sz / 2;
+    int w = sz / 3;
+    Vector<Point> pts;
+    pts << Point(cx - w/2, cy - w) << Point(cx + w/2, cy) << Point(cx - w/2, cy + w);
+    p.DrawPolyline(pts, 2, ink);
+    return ib;
+}
+
+static Image MakeChevronDown(int sz, Color ink) {
+    ImageBuffer ib(sz, sz);
+    Fill(~ib, RGBAZero(), ib.GetLength());
+    BufferPainter p(ib); // AA vector drawing
+    int cx = sz / 2, cy = sz / 2;
+    int w = sz / 3;
+    Vector<Point> pts;
+    pts << Point(cx - w, cy - w/2) << Point(cx, cy + w/2) << Point(cx + w, cy - w/2);
+    p.DrawPolyline(pts, 2, ink);
+    return ib;
+}
+
+// High‑fidelity lock icon with anti‑aliasing, scaled to sz×sz, drawn in 'ink'
+static Image MakeChevronLock(int sz, Color ink) {
+    // Transparent buffer
+    ImageBuffer ib(sz, sz);
+    Fill(~ib, RGBAZero(), ib.GetLength());
+    BufferPainter p(ib); // AA vector drawing
+
+    // Proportional inset so thick strokes don’t clip at edges
+    const double margin = max(0.5, round(sz * 0.04));
+    const Rectf inset(margin, margin, sz - margin, sz - margin);
+    const double W = inset.GetWidth();
+    const double H = inset.GetHeight();
+
+    auto X = [&](double fx){ return inset.left + W * fx; };
+    auto Y = [&](double fy){ return inset.top  + H * fy; };
+
+    // Stroke thickness scaled to size (looks good ~12–28px)
+    const double T = max(0.5, round(sz * 0.18));     // outline thickness
+    const double Tk = max(0.5, round(T * 0.85));     // keyhole stem
+
+    // 1) Body rectangle outline (your proportions)
+    p.Begin();
+    p.Move(Pointf(X(0.1288), Y(0.4206)));
+    p.Line(Pointf(X(0.8498), Y(0.4206)));
+    p.Line(Pointf(X(0.8498), Y(0.9442)));
+    p.Line(Pointf(X(0.1288), Y(0.9442)));
+    p.Close();
+    p.Stroke(T, ink);
+
+    // 2) Shackle curve (cubic)
+    p.Begin();
+    p.Move(Pointf(X(0.2575), Y(0.3863)));
+    p.Cubic(Pointf(X(0.2575), Y(0.0086)),
+            Pointf(X(0.7210), Y(0.0086)),
+            Pointf(X(0.7210), Y(0.3863)));
+    p.Stroke(T, ink);
+
+    // 3) Keyhole circle (filled)
+    const double R = min(W, H) * 0.0716;
+    p.Begin();
+    p.Circle(X(0.4614), Y(0.6438), R);
+    p.Fill(ink);
+
+    // 4) Keyhole stem (stroke)
+    p.Begin();
+    p.Move(Pointf(X(0.4635), Y(0.8219)));
+    p.Line(Pointf(X(0.4635), Y(0.6953)));
+    p.Stroke(Tk, ink);
+
+    return ib;
+}
+
+// Header icons are shared by all AccordionCtrl instances. The key covers everything the raster
+// depends on (ink and the DPI-scaled size), so a Chameleon color or DPI change simply misses
+// and renders a fresh set.
+Image AccordionCtrl::CachedIcon(int kind, int px, Color ink) {
+    static VectorMap<int64, Image> cache;
+
+    int64 key = (int64)(((uint64)ink.GetRaw() << 32) | ((uint64)(px & 0xffff) << 4) | (uint64)kind);
+    int q = cache.Find(key);
+    if(q >= 0)
+        return cache[q];
+
+    if(cache.GetCount() >= 64) // stale theme/size variants
+        cache.Clear();
+
+    Image img = kind == ICON_LOCK   ? MakeChevronLock(px, ink)
+              : kind == ICON_OPENED ? MakeChevronDown(px, ink)
+              :                       MakeChevronRight(px, ink);
+    cache.Add(key, img);
+    return img;
+}
+
+Image AccordionCtrl::GetIcon(int kind) const {
+    const Image& custom = kind == ICON_OPENED ? iconOpened : kind == ICON_CLOSED ? iconClosed : Image();
+    if(!custom.IsEmpty())
+        return custom;
+    return CachedIcon(kind, DPI(style->iconCx), SColorText());
+}
+
+}
@@ -0,0 +1,75 @@
+#include "AccordionCtrl.h"
+
+namespace Upp {
+
+// Prewarming: hover dwell and keyboard focus name one target section; when TIMEID_PREWARM
+// fires its body goes through the usual lazy path (RealizeBody + BodyContentCy) while it is
+// still closed, so the open that follows only has to animate.
+
+AccordionCtrl& AccordionCtrl::Prewarm(bool on, int dwell_ms, int max_jobs, int64 max_bytes) {
+    prewarm = on;
+    prewarmDwellMs = max(0, dwell_ms);
+    prewarmJobs = max(0, max_jobs);
+    prewarmMaxBytes = max<int64>(0, max_bytes);
+    if(!on) {
+        prewarmTarget = nullptr;
+        KillTimeCallback(TIMEID_PREWARM);
+    }
+    return *this;
+}
+
+void AccordionCtrl::SchedulePrewarm(int i, int delay) {
+    if(model || i < 0 || i >= sections.GetCount()) return;
+    Section& s = sections[i];
+    if(openBits[i] || !s.factory || s.bodyBuilt) return;
+    prewarmTarget = &s;
+    KillSetTimeCallback(delay, [=] { PrewarmTarget(); }, TIMEID_PREWARM);
+}
+
+void AccordionCtrl::PrewarmTarget() {
+    Section *s = prewarmTarget;
+    prewarmTarget = nullptr;
+    if(!s) return;
+    int i = IndexOf(*s);
+    if(openBits[i] || !s->factory || s->bodyBuilt) return;
+    if(PrewarmBytes() >= prewarmMaxBytes) return;
+    if(s->async) {
+        int jobs = 0;
+        for(Section *q : asyncPending)
+            if(!openBits[IndexOf(*q)]) jobs++;
+        if(jobs >= prewarmJobs) return;
+    }
+    TraceScope tr(*this, "Prewarm", i);
+    RealizeBody(i);   // runs the factory or starts the async worker
+    BodyContentCy(i); // async bodies are measured when their result arrives
+    prewarmed.Add(s);
+    if(!s->async)
+        BodyClosed(*s);
+}
+
+void AccordionCtrl::ForgetPrewarm(Section& s) {
+    if(prewarmTarget == &s) {
+        prewarmTarget = nullptr;
+        KillTimeCallback(TIMEID_PREWARM);
+    }
+    for(int k = 0; k < prewarmed.GetCount(); k++)
+        if(prewarmed[k] == &s) { prewarmed.Remove(k); break; }
+}
+
+int64 AccordionCtrl::CtrlBytes(const Ctrl& c) {
+    int64 n = sizeof(Ctrl);
+    for(Ctrl *q = c.GetFirstChild(); q; q = q->GetNext())
+        n += CtrlBytes(*q);
+    return n;
+}
+
+int64 AccordionCtrl::PrewarmBytes() const {
+    // Estimate: the Ctrl trees of the bodies built ahead
+    int64 n = 0;
+    for(const Section *s : prewarmed)
+        if(s->body)
+            n += CtrlBytes(*s->body);
+    return n;
+}
+
+}
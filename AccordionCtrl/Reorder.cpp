@@ -0,0 +1,154 @@
+#include "AccordionCtrl.h"
+
+namespace Upp {
+
+// Reordering: the new sequence of Section pointers is computed first, then ApplyOrder
+// re-seats them in 'sections' without destroying any Section or its Ctrls.
+
+void AccordionCtrl::AddSubtree(Vector<Section*>& order, int i) const {
+    for(int j = i, e = SubtreeEnd(i); j < e; j++)
+        order.Add(const_cast<Section *>(&sections[j]));
+}
+
+void AccordionCtrl::MoveSection(int from, int to, bool animate) {
+    ASSERT(!model && from >= 0 && from < sections.GetCount() && to >= 0 && to < sections.GetCount());
+    ASSERT(sections[from].parent == sections[to].parent);
+    if(from == to) return;
+
+    // Moving up the block goes before 'to', moving down after the subtree of 'to'
+    int fe = SubtreeEnd(from);
+    int at = to < from ? to : SubtreeEnd(to);
+    Vector<Section*> order;
+    for(int i = 0; i < sections.GetCount();) {
+        if(i == at)
+            AddSubtree(order, from);
+        if(i == from) {
+            i = fe;
+            continue;
+        }
+        order.Add(&sections[i++]);
+    }
+    if(at == sections.GetCount())
+        AddSubtree(order, from);
+    ApplyOrder(order, animate);
+}
+
+void AccordionCtrl::SwapSections(int i, int j, bool animate) {
+    ASSERT(!model && i >= 0 && i < sections.GetCount() && j >= 0 && j < sections.GetCount());
+    ASSERT(sections[i].parent == sections[j].parent);
+    if(i == j) return;
+    if(i > j) Swap(i, j);
+
+    int ie = SubtreeEnd(i), je = SubtreeEnd(j);
+    Vector<Section*> order;
+    for(int k = 0; k < i; k++)
+        order.Add(&sections[k]);
+    AddSubtree(order, j);
+    for(int k = ie; k < j; k++)
+        order.Add(&sections[k]);
+    AddSubtree(order, i);
+    for(int k = je; k < sections.GetCount(); k++)
+        order.Add(&sections[k]);
+    ApplyOrder(order, animate);
+}
+
+void AccordionCtrl::SortSections(Function<bool (int, int)> less, bool animate) {
+    ASSERT(!model);
+    Vector<Section*> order;
+    // Sorts the siblings in [lo, hi), then the children of each of them
+    auto sort = [&](int lo, int hi, auto& self) -> void {
+        Vector<int> sib;
+        for(int j = lo; j < hi; j = SubtreeEnd(j))
+            sib.Add(j);
+        StableSort(sib, [&](int a, int b) { return less(a, b); });
+        for(int j : sib) {
+            order.Add(&sections[j]);
+            self(j + 1, SubtreeEnd(j), self);
+        }
+    };
+    sort(0, sections.GetCount(), sort);
+    ApplyOrder(order, animate);
+}
+
+void AccordionCtrl::ApplyOrder(const Vector<Section*>& order, bool animate) {
+    int n = sections.GetCount();
+    ASSERT(order.GetCount() == n);
+
+    // Everything tied to positions is captured by Section before the array changes
+    Vector<int> from;    // old position of order[k]
+    for(Section *s : order)
+        from.Add(IndexOf(*s));
+    Vector<int> oldTop;
+    if(animate && animEnabled) {
+        UpdateGeometry();
+        for(int i = 0; i < n; i++)
+            oldTop.Add(RowTop(i) + sections[i].shift);
+    }
+    Section *hot = hotSection >= 0 ? &sections[hotSection] : nullptr;
+    Section *focus = focusSection >= 0 ? &sections[focusSection] : nullptr;
+    Bits open = pick(openBits), lock = pick(lockBits);
+    openBits.Clear();
+    lockBits.Clear();
+
+    while(sections.GetCount())
+        sections.PopDetach();
+    for(int k = 0; k < n; k++) {
+        sections.Add(order[k]);
+        openBits.Set(k, open[from[k]]);
+        lockBits.Set(k, lock[from[k]]);
+    }
+
+    SectionsMoved(0);
+    hotSection = hot ? IndexOf(*hot) : -1;
+    focusSection = focus ? IndexOf(*focus) : -1;
+    pressedSection = -1;
+    GeometryChanged();
+
+    if(oldTop.GetCount()) {
+        // Rows start at their old place and slide to the new one on the shared clock
+        UpdateGeometry();
+        for(int k = 0; k < n; k++) {
+            Section& s = sections[k];
+            int dy = oldTop[from[k]] - RowTop(k);
+            if(s.hidden || dy == 0) {
+                if(s.shiftFrom) { // was sliding and is already in place now
+                    s.shiftFrom = s.shift = 0;
+                    for(int j = 0; j < reflow.GetCount(); j++)
+                        if(reflow[j] == &s) { reflow.Remove(j); break; }
+                }
+                continue;
+            }
+            if(s.shiftFrom == 0)
+                reflow.Add(&s);
+            s.shiftFrom = s.shift = dy;
+            reflowMax = max(reflowMax, abs(dy));
+        }
+        reflowStart = msecs();
+        if(reflow.GetCount())
+            StartClock();
+    }
+    else { // rows still sliding from an earlier order jump to their place
+        for(Section *s : reflow)
+            s->shiftFrom = s->shift = 0;
+        reflow.Clear();
+    }
+    Relayout();
+}
+
+AccordionCtrl& AccordionCtrl::DragReorder(bool on) {
+    dragReorder = on;
+    return *this;
+}
+
+int AccordionCtrl::DragTarget(Point p) const {
+    int i = SectionAt(p.y + viewTop);
+    if(i < 0 || pressedSection < 0) return -1;
+    // Climb to the ancestor that is a sibling of the dragged section
+    const Section *parent = sections[pressedSection].parent;
+    const Section *s = &sections[i];
+    while(s && s->parent != parent)
+        s = s->parent;
+    return s ? IndexOf(*s) : -1;
+}
+
+}
@@ -0,0 +1,70 @@
+#include "AccordionCtrl.h"
+
+namespace Upp {
+
+// Runtime counters. Layout/Paint/AnimFrame accumulate into 'stats' while enabled, the
+// sampled fields (timers, realized Ctrls, memory) are computed here on demand.
+
+AccordionCtrl& AccordionCtrl::EnableStats(bool on, int period_ms) {
+    statsOn = on;
+    if(on && period_ms > 0)
+        SetTimeCallback(-period_ms, [=] { WhenStats(GetStats()); }, TIMEID_STATS);
+    else
+        KillTimeCallback(TIMEID_STATS);
+    return *this;
+}
+
+void AccordionCtrl::ResetStats() {
+    stats = Stats();
+}
+
+static int64 ImageBytes(const Image& m)
+{
+    return m.GetLength() * sizeof(RGBA);
+}
+
+AccordionCtrl::Stats AccordionCtrl::GetStats() const {
+    Stats st = stats;
+    st.liveTimers = 0;
+    for(int id : { TIMEID_SCROLL, TIMEID_ANIM, TIMEID_STATS, TIMEID_MEASURE, TIMEID_PREWARM })
+        if(ExistsTimeCallback(id))
+            st.liveTimers++;
+
+    st.headers = st.bodies = 0;
+    int64 mem = sizeof(*this);
+    if(model) {
+        for(const Slot& q : slots) {
+            st.headers++;
+            if(q.content) st.bodies++;
+        }
+        mem += slots.GetCount() * (sizeof(Slot) + sizeof(void *)) + vbody.GetCount() * sizeof(int);
+    }
+    else {
+        for(const Section& s : sections) {
+            mem += sizeof(Section) + sizeof(void *) + s.title.GetCount() + s.key.GetCount();
+            mem += s.lower.GetCount() + s.keywords.GetCount();
+            mem += ImageBytes(s.snapshot);
+            if(s.headerImg) {
+                mem += sizeof(HeaderImages);
+                for(const Image& m : s.headerImg->img)
+                    mem += ImageBytes(m);
+            }
+            if(s.header) {
+                st.headers++;
+                mem += sizeof(HeaderPane);
+            }
+            if(s.body) {
+                st.bodies++;
+                mem += sizeof(BodyPane);
+            }
+        }
+        mem += 2 * (sections.GetCount() / 8 + 4);                    // open/lock bits
+        mem += keys.GetCount() * (sizeof(String) + sizeof(void *) + 2 * sizeof(int));
+        mem += (filterHits.GetCount() + autoOpened.GetCount()) * sizeof(void *);
+    }
+    mem += rows.tree.GetCount() * sizeof(int) + shown.GetCount() * sizeof(void *);
+    st.memory = mem;
+    return st;
+}
+
+}
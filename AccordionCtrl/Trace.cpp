@@ -0,0 +1,57 @@
+#include "AccordionCtrl.h"
+
+namespace Upp {
+
+// Trace recorder: TraceScope writes begin/end records into a fixed ring buffer, so tracing
+// can stay on for a long session; GetTraceJson exports the retained window.
+
+AccordionCtrl& AccordionCtrl::EnableTrace(bool on, int capacity) {
+    tracing = on;
+    ClearTrace();
+    if(on)
+        trace.SetCount(max(capacity, 16));
+    else
+        trace.Clear();
+    return *this;
+}
+
+void AccordionCtrl::ClearTrace() {
+    traceHead = 0;
+    traceWrapped = false;
+}
+
+void AccordionCtrl::Trace(char phase, const char *name, int section) const {
+    if(trace.IsEmpty()) return;
+    TraceRec& r = trace[traceHead];
+    r.ts = usecs();
+    r.name = name;
+    r.section = section;
+    r.phase = phase;
+    if(++traceHead == trace.GetCount()) {
+        traceHead = 0;
+        traceWrapped = true;
+    }
+}
+
+String AccordionCtrl::GetTraceJson() const {
+    JsonArray events;
+    int n = traceWrapped ? trace.GetCount() : traceHead;
+    int q = traceWrapped ? traceHead : 0;
+    Index<const char *> open; // names with a retained begin event
+    for(int k = 0; k < n; k++) {
+        const TraceRec& r = trace[(q + k) % trace.GetCount()];
+        if(r.phase == 'B')
+            open.FindAdd(r.name);
+        else
+        if(open.Find(r.name) < 0)
+            continue; // begin event was overwritten by the ring buffer
+        Json ev("name", r.name);
+        ev("ph", String(r.phase, 1))("ts", r.ts)("pid", 1)("tid", 1);
+        if(r.section >= 0)
+            ev("args", Json("section", r.section));
+        events << ev;
+    }
+    return Json("traceEvents", events)("displayTimeUnit", "ms");
+}
+
+}
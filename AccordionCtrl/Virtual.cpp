@@ -0,0 +1,157 @@
+#include "AccordionCtrl.h"
+
+namespace Upp {
+
+// Virtual mode: rows come from a Model, body heights live in vbody and only the rows
+// inside the viewport own a header/body pane taken from the 'slots' pool.
+
+AccordionCtrl& AccordionCtrl::SetModel(Model& m) {
+    if(model != &m) {
+        Clear();
+        model = &m;
+    }
+    ModelChanged();
+    return *this;
+}
+
+AccordionCtrl& AccordionCtrl::ClearModel() {
+    if(!model) return *this;
+    ReleaseSlots();
+    slots.Clear();
+    model = nullptr;
+    vbody.Clear();
+    hotSection = -1;
+    pressedSection = -1;
+    focusSection = -1;
+    GeometryChanged();
+    Relayout();
+    return *this;
+}
+
+void AccordionCtrl::ModelChanged() {
+    if(!model) return;
+    ReleaseSlots();
+    SyncModelRows();
+    hotSection = -1;
+    pressedSection = -1;
+    focusSection = -1;
+    Relayout();
+}
+
+void AccordionCtrl::ModelChanged(int i) {
+    if(!model) return;
+    ASSERT(i >= 0 && i < GetCount());
+    int cy = model->IsOpen(i) ? max(0, model->GetBodyHeight(i)) : 0;
+    if(vbody[i] != cy) {
+        SetBodyCy(i, cy);
+        Relayout();
+    }
+    else
+        RefreshSection(i);
+}
+
+void AccordionCtrl::SyncModelRows() {
+    int n = model->GetCount();
+    vbody.SetCount(n);
+    for(int i = 0; i < n; i++)
+        vbody[i] = model->IsOpen(i) ? max(0, model->GetBodyHeight(i)) : 0;
+    GeometryChanged();
+}
+
+void AccordionCtrl::SetModelOpen(int i, bool open) {
+    if(model->IsOpen(i) == open || model->IsLocked(i)) return;
+
+    if(!open && enforceOne) {
+        int openCount = 0;
+        for(int j = 0; j < GetCount() && openCount < 2; j++)
+            if(model->IsOpen(j)) openCount++;
+        if(openCount <= 1) return;
+    }
+    if(WhenBeforeToggle(i)) return;
+
+    model->SetOpen(i, open);
+    if(open && singleExpand) {
+        if(updateDepth) updateKeep = i;
+        else            CloseOthers(i);
+    }
+    SetBodyCy(i, open ? max(0, model->GetBodyHeight(i)) : 0);
+    Relayout();
+    NotifyState(i, open);
+}
+
+void AccordionCtrl::LayoutVirtual(int first, int last) {
+    // Give back the panes of rows that left the viewport
+    for(Slot& q : slots)
+        if(q.row >= 0 && (q.row < first || q.row > last))
+            ReleaseSlot(q);
+
+    if(last < first) return;
+
+    Vector<Slot*> byRow;
+    byRow.SetCount(last - first + 1, nullptr);
+    for(Slot& q : slots)
+        if(q.row >= 0) byRow[q.row - first] = &q;
+
+    int nextFree = 0;
+    for(int i = first; i <= last; i++) {
+        Slot *q = byRow[i - first];
+        if(!q) {
+            while(nextFree < slots.GetCount() && slots[nextFree].row >= 0)
+                nextFree++;
+            if(nextFree < slots.GetCount())
+                q = &slots[nextFree];
+            else {
+                q = &slots.Add();
+                q->header.owner = this;
+                q->body.owner = this;
+                q->header.Hide();
+                q->body.Hide();
+                Add(q->header);
+                Add(q->body);
+            }
+            q->row = i;
+        }
+
+        q->header.index = i;
+        q->header.SetRect(GetHeaderRect(i));
+        q->header.Show();
+
+        if(vbody[i] > 0) {
+            if(!q->content) {
+                if(Ctrl *c = model->CreateBody(i)) {
+                    q->content.Attach(c);
+                    q->body.Add(c->SizePos());
+                }
+            }
+            q->body.SetRect(GetBodyRect(i));
+            q->body.Show();
+        }
+        else {
+            if(q->content) {
+                model->ReleaseBody(i, *q->content);
+                q->content.Clear();
+            }
+            q->body.Hide();
+        }
+    }
+}
+
+void AccordionCtrl::ReleaseSlot(Slot& q) {
+    if(q.content) {
+        if(model) // after ModelChanged the row may be gone
+            model->ReleaseBody(q.row < model->GetCount() ? q.row : -1, *q.content);
+        q.content.Clear();
+    }
+    q.header.Hide();
+    q.body.Hide();
+    q.header.index = -1;
+    q.row = -1;
+}
+
+void AccordionCtrl::ReleaseSlots() {
+    for(Slot& q : slots)
+        if(q.row >= 0)
+            ReleaseSlot(q);
+}
+
+}
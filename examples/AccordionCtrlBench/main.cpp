@@ -0,0 +1,113 @@
+#include <CtrlLib/CtrlLib.h>
+#include <AccordionCtrl/AccordionCtrl.h>
+
+using namespace Upp;
+
+// Headless timings of AccordionCtrl hot paths. No window is opened: the control is sized
+// directly and painted into an ImageDraw. Every variant/N/operation gives one CSV row,
+// so runs of two revisions can be compared with any diff or spreadsheet tool.
+//
+//   AccordionCtrlBench [out.csv] [maxN]
+
+enum { MULTI, SINGLE, LOCKED, VARIANT_COUNT };
+
+static const char *variantName[VARIANT_COUNT] = { "multi", "single", "locked" };
+static const Size  viewSize(400, 600);
+
+struct Bench {
+    FileOut out;
+    String  variant;
+    int     n = 0;
+
+    void Row(const char *op, int reps, int64 us) {
+        String line;
+        line << variant << ',' << n << ',' << op << ',' << reps << ',' << us << ','
+             << Format("%.3f", (double)us / max(reps, 1));
+        out.PutLine(line);
+        Cout() << line << '\n';
+    }
+
+    template <class F>
+    void Measure(const char *op, int reps, F fn) {
+        int64 t0 = usecs();
+        for(int r = 0; r < reps; r++)
+            fn(r);
+        Row(op, reps, usecs(t0));
+    }
+
+    void Run(int kind, int count);
+};
+
+void Bench::Run(int kind, int count)
+{
+    variant = variantName[kind];
+    n = count;
+
+    Array<StaticRect> bodies;   // declared first, so the control lets go of them first
+    AccordionCtrl     acc;
+    acc.SetAnimationEnabled(false);
+    acc.SetRect(Rect(viewSize));
+    if(kind == SINGLE)
+        acc.SingleExpand();
+
+    // Bodies are lazy, as in a real settings tree: built the first time a section opens
+    Measure("insert", n, [&](int r) {
+        acc.AddSection("Section " + AsString(r), [&, r](ParentCtrl& p) {
+            p.Add(bodies.Add().Color(SColorPaper()).HSizePos().TopPos(0, 40 + r % 5 * 20));
+        });
+    });
+
+    if(kind == LOCKED)  // every 4th section locked, alternating open and closed
+        for(int i = 0; i < n; i += 4) {
+            if(i & 4) acc.Open(i, false);
+            acc.SetLocked(i, true);
+        }
+
+    Measure("layout", 200, [&](int) { acc.Layout(); });
+
+    ImageDraw iw(viewSize);
+    Measure("paint", 100, [&](int) { acc.Paint(iw); });
+    Measure("draw_ctrl", 20, [&](int) { acc.DrawCtrl(iw); });
+
+    SeedRandom(1);
+    Measure("toggle", 1000, [&](int) { acc.Toggle(Random(n), false); });
+
+    int hits = 0;
+    Measure("hit_test", 100000, [&](int) {
+        if(acc.HitTestHeader(Point(viewSize.cx / 2, Random(viewSize.cy))) >= 0)
+            hits++;
+    });
+
+    Measure("close_all", 1, [&](int) { acc.CloseAll(false); });
+    Measure("open_all", 1, [&](int) { acc.OpenAll(false); });      // runs the body factories
+    Measure("close_all_warm", 1, [&](int) { acc.CloseAll(false); });
+    Measure("open_all_warm", 1, [&](int) { acc.OpenAll(false); });
+    Measure("layout_open", 200, [&](int) { acc.Layout(); });
+    Measure("paint_open", 100, [&](int) { acc.Paint(iw); });
+
+    String data;
+    Measure("store", 5, [&](int) { data = StoreAsString(acc); });
+    Measure("load", 5, [&](int) { LoadFromString(acc, data); });
+
+    // Last, as it grows the control: every insert renumbers and shifts all rows after it
+    Measure("insert_front", min(n, 1000), [&](int r) { acc.InsertSection(0, "Front " + AsString(r)); });
+}
+
+CONSOLE_APP_MAIN
+{
+    const Vector<String>& cmd = CommandLine();
+    String path = cmd.GetCount() > 0 ? cmd[0] : String("AccordionCtrlBench.csv");
+    int    maxN = cmd.GetCount() > 1 ? max(10, StrInt(cmd[1])) : 100000;
+
+    Bench bench;
+    if(!bench.out.Open(path)) {
+        Cout() << "Cannot create " << path << '\n';
+        SetExitCode(1);
+        return;
+    }
+    bench.out.PutLine("variant,n,op,reps,total_us,us_per_op");
+
+    for(int n = 10; n <= maxN; n *= 10)
+        for(int kind = 0; kind < VARIANT_COUNT; kind++)
+            bench.Run(kind, n);
+}